@@ -0,0 +1,202 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerarchive.h"
+
+#include <QBuffer>
+#include <QTest>
+#include <KConfig>
+#include <KConfigGroup>
+
+class KTimerArchiveTest : public QObject {
+ Q_OBJECT
+
+ private slots:
+    void roundTrip();
+    void throughConfig();
+    void appended();
+    void truncated();
+    void notAnArchive();
+
+ private:
+    static KTimerJobRecord backupRecord();
+    static void compare( const KTimerJobRecord &actual, const KTimerJobRecord &expected );
+    // An archive of the backup record and a default one.
+    static QByteArray archive();
+};
+
+
+KTimerJobRecord KTimerArchiveTest::backupRecord()
+{
+    KTimerJobRecord record;
+    record.delay = 86400;
+    record.flags = KTimerJobRecord::Loop | KTimerJobRecord::PipeOutput;
+    record.captureSize = 16;
+    record.slack = 600;
+    record.maxRuntime = 3600;
+    record.priority = 0;
+    record.command = QStringLiteral( "rsync -a ~/ /backup/" );
+    record.onSchedule = QStringLiteral( "logger scheduled" );
+    record.onPause = QStringLiteral( "logger paused" );
+    record.onResume = QStringLiteral( "logger resumed" );
+    record.onStop = QStringLiteral( "logger stopped" );
+    record.onSuccess = QStringLiteral( "notify-send ✓" );
+    record.onFailure = QStringLiteral( "notify-send ✗" );
+    record.group = QStringLiteral( "nightly" );
+    record.catchUp = 1;
+    record.maxCatchUp = 3;
+    return record;
+}
+
+
+void KTimerArchiveTest::compare( const KTimerJobRecord &actual, const KTimerJobRecord &expected )
+{
+    QCOMPARE( actual.delay, expected.delay );
+    QCOMPARE( actual.flags, expected.flags );
+    QCOMPARE( actual.captureSize, expected.captureSize );
+    QCOMPARE( actual.slack, expected.slack );
+    QCOMPARE( actual.maxRuntime, expected.maxRuntime );
+    QCOMPARE( actual.priority, expected.priority );
+    QCOMPARE( actual.command, expected.command );
+    QCOMPARE( actual.onSchedule, expected.onSchedule );
+    QCOMPARE( actual.onPause, expected.onPause );
+    QCOMPARE( actual.onResume, expected.onResume );
+    QCOMPARE( actual.onStop, expected.onStop );
+    QCOMPARE( actual.onSuccess, expected.onSuccess );
+    QCOMPARE( actual.onFailure, expected.onFailure );
+    QCOMPARE( actual.group, expected.group );
+    QCOMPARE( actual.catchUp, expected.catchUp );
+    QCOMPARE( actual.maxCatchUp, expected.maxCatchUp );
+}
+
+
+QByteArray KTimerArchiveTest::archive()
+{
+    QBuffer buffer;
+    buffer.open( QIODevice::WriteOnly );
+    KTimerJobWriter writer( &buffer );
+    writer.write( backupRecord() );
+    writer.write( KTimerJobRecord() );
+    writer.finish();
+    return buffer.data();
+}
+
+
+void KTimerArchiveTest::roundTrip()
+{
+    QByteArray data = archive();
+    QVERIFY( data.startsWith( "KTJB" ) );
+
+    QBuffer buffer( &data );
+    QVERIFY( buffer.open( QIODevice::ReadOnly ) );
+    KTimerJobReader reader( &buffer );
+
+    KTimerJobRecord record;
+    QVERIFY( reader.readNext( &record ) );
+    compare( record, backupRecord() );
+    QVERIFY( reader.readNext( &record ) );
+    compare( record, KTimerJobRecord() );
+
+    QVERIFY( !reader.readNext( &record ) );
+    QVERIFY( !reader.hasError() );
+    QVERIFY( buffer.atEnd() );
+}
+
+
+// Imported into a config file and exported again, byte for byte.
+void KTimerArchiveTest::throughConfig()
+{
+    QByteArray data = archive();
+    KConfig cfg( QString(), KConfig::SimpleConfig );
+
+    QBuffer in( &data );
+    QVERIFY( in.open( QIODevice::ReadOnly ) );
+    KTimerJobReader reader( &in );
+    QCOMPARE( reader.readAll( &cfg ), 2 );
+    QCOMPARE( cfg.group( "Jobs" ).readEntry( "Number", 0 ), 2 );
+    QCOMPARE( cfg.group( "Job0" ).readPathEntry( "Command", QString() ), backupRecord().command );
+    QCOMPARE( cfg.group( "Job0" ).readEntry( "Group", QString() ), QStringLiteral( "nightly" ) );
+
+    QBuffer out;
+    QVERIFY( out.open( QIODevice::WriteOnly ) );
+    KTimerJobWriter writer( &out );
+    QCOMPARE( writer.writeAll( &cfg ), 2 );
+    QCOMPARE( out.data(), data );
+}
+
+
+// Imported jobs go after those already there.
+void KTimerArchiveTest::appended()
+{
+    QByteArray data = archive();
+    KConfig cfg( QString(), KConfig::SimpleConfig );
+    cfg.group( "Jobs" ).writeEntry( "Number", 1 );
+    cfg.group( "Job0" ).writePathEntry( "Command", QStringLiteral( "true" ) );
+
+    QBuffer in( &data );
+    QVERIFY( in.open( QIODevice::ReadOnly ) );
+    KTimerJobReader reader( &in );
+    QCOMPARE( reader.readAll( &cfg ), 2 );
+    QCOMPARE( cfg.group( "Jobs" ).readEntry( "Number", 0 ), 3 );
+    QCOMPARE( cfg.group( "Job0" ).readPathEntry( "Command", QString() ), QStringLiteral( "true" ) );
+    QCOMPARE( cfg.group( "Job1" ).readPathEntry( "Command", QString() ), backupRecord().command );
+    QCOMPARE( cfg.group( "Job2" ).readEntry( "Delay", 0 ), 100 );
+}
+
+
+void KTimerArchiveTest::truncated()
+{
+    // Without the end marker.
+    QByteArray data = archive();
+    data.chop( 4 );
+
+    QBuffer buffer( &data );
+    QVERIFY( buffer.open( QIODevice::ReadOnly ) );
+    KTimerJobReader reader( &buffer );
+
+    KTimerJobRecord record;
+    QVERIFY( reader.readNext( &record ) );
+    QVERIFY( reader.readNext( &record ) );
+    QVERIFY( !reader.readNext( &record ) );
+    QVERIFY( reader.hasError() );
+
+    // Cut within a record.
+    data = archive().left( 30 );
+    QBuffer cut( &data );
+    QVERIFY( cut.open( QIODevice::ReadOnly ) );
+    KTimerJobReader cutReader( &cut );
+    QVERIFY( !cutReader.readNext( &record ) );
+    QVERIFY( cutReader.hasError() );
+}
+
+
+void KTimerArchiveTest::notAnArchive()
+{
+    QByteArray data( "[Jobs]\nNumber=1\n" );
+    QBuffer buffer( &data );
+    QVERIFY( buffer.open( QIODevice::ReadOnly ) );
+    KTimerJobReader reader( &buffer );
+
+    KTimerJobRecord record;
+    QVERIFY( !reader.readNext( &record ) );
+    QVERIFY( reader.hasError() );
+}
+
+QTEST_GUILESS_MAIN(KTimerArchiveTest)
+
+#include "ktimerarchivetest.moc"
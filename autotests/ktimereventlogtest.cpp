@@ -0,0 +1,175 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimereventlog.h"
+
+#include <limits>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+class KTimerEventLogTest : public QObject {
+ Q_OBJECT
+
+ private slots:
+    void init();
+    void bisection();
+    void wraparound();
+    void jobAndLimit();
+    void timesKeptInOrder();
+    void reopen();
+
+ private:
+    // 'count' events a second apart from 1 s on, alternately of job 1 and job 2.
+    void fill( KTimerEventLog *log, int count );
+    static QList<qint64> times( const QVector<KTimerEvent> &events );
+
+    QTemporaryDir m_dir;
+    QString m_path;
+};
+
+static const qint64 s_forever = std::numeric_limits<qint64>::max();
+
+
+void KTimerEventLogTest::init()
+{
+    QVERIFY( m_dir.isValid() );
+    m_path = m_dir.path() + QStringLiteral( "/events.log" );
+    QFile::remove( m_path );
+}
+
+
+void KTimerEventLogTest::fill( KTimerEventLog *log, int count )
+{
+    for( int i=0; i<count; ++i ) {
+        const KTimerEvent event = { ( i+1 )*1000LL, quint32( i%2 ? 2 : 1 ), KTimerEvent::Fired, 0, 0 };
+        log->append( event );
+    }
+}
+
+
+QList<qint64> KTimerEventLogTest::times( const QVector<KTimerEvent> &events )
+{
+    QList<qint64> list;
+    for( int i=0; i<events.count(); ++i )
+        list.append( events.at( i ).time );
+    return list;
+}
+
+
+void KTimerEventLogTest::bisection()
+{
+    KTimerEventLog log;
+    QVERIFY( log.open( m_path, 64 ) );
+    fill( &log, 40 );
+
+    // Both ends inclusive, also between two events.
+    QCOMPARE( times( log.query( 0, 10000, 12000 ) ), QList<qint64>() << 10000 << 11000 << 12000 );
+    QCOMPARE( times( log.query( 0, 9500, 12500 ) ), QList<qint64>() << 10000 << 11000 << 12000 );
+    QCOMPARE( times( log.query( 0, 1000, 1000 ) ), QList<qint64>() << 1000 );
+    QCOMPARE( times( log.query( 0, 40000, s_forever ) ), QList<qint64>() << 40000 );
+
+    QVERIFY( log.query( 0, 0, 500 ).isEmpty() );
+    QVERIFY( log.query( 0, 40500, s_forever ).isEmpty() );
+    QVERIFY( log.query( 0, 12000, 10000 ).isEmpty() );
+}
+
+
+void KTimerEventLogTest::wraparound()
+{
+    KTimerEventLog log;
+    QVERIFY( log.open( m_path, 8 ) );
+    fill( &log, 20 );
+    QCOMPARE( log.written(), quint64( 20 ) );
+    QCOMPARE( log.capacity(), quint32( 8 ) );
+
+    // Only the last eight are left, and the search starts at the oldest of them.
+    QCOMPARE( times( log.query( 0, 0, s_forever ) ),
+              QList<qint64>() << 13000 << 14000 << 15000 << 16000 << 17000 << 18000 << 19000 << 20000 );
+    QCOMPARE( times( log.query( 0, 0, 14000 ) ), QList<qint64>() << 13000 << 14000 );
+    QCOMPARE( times( log.query( 0, 15500, 18000 ) ), QList<qint64>() << 16000 << 17000 << 18000 );
+    QVERIFY( log.query( 0, 0, 12000 ).isEmpty() );
+}
+
+
+void KTimerEventLogTest::jobAndLimit()
+{
+    KTimerEventLog log;
+    QVERIFY( log.open( m_path, 8 ) );
+    fill( &log, 20 );
+
+    QCOMPARE( times( log.query( 1, 0, s_forever ) ), QList<qint64>() << 13000 << 15000 << 17000 << 19000 );
+    QCOMPARE( times( log.query( 2, 15000, s_forever, 2 ) ), QList<qint64>() << 16000 << 18000 );
+    QCOMPARE( times( log.query( 0, 0, s_forever, 3 ) ), QList<qint64>() << 13000 << 14000 << 15000 );
+    QVERIFY( log.query( 3, 0, s_forever ).isEmpty() );
+    QVERIFY( log.query( 0, 0, s_forever, 0 ).isEmpty() );
+}
+
+
+void KTimerEventLogTest::timesKeptInOrder()
+{
+    KTimerEventLog log;
+    QVERIFY( log.open( m_path, 8 ) );
+    fill( &log, 3 );
+
+    // The wall clock went back: the event is logged at the last time seen.
+    const KTimerEvent event = { 500, 7, KTimerEvent::Failed, 1, 20 };
+    log.append( event );
+
+    const QVector<KTimerEvent> events = log.query( 7, 0, s_forever );
+    QCOMPARE( events.count(), 1 );
+    QCOMPARE( events.at( 0 ).time, qint64( 3000 ) );
+    QCOMPARE( events.at( 0 ).type, quint32( KTimerEvent::Failed ) );
+    QCOMPARE( events.at( 0 ).status, 1 );
+    QCOMPARE( events.at( 0 ).duration, quint32( 20 ) );
+    QCOMPARE( times( log.query( 0, 3000, 3000 ) ), QList<qint64>() << 3000 << 3000 );
+}
+
+
+void KTimerEventLogTest::reopen()
+{
+    {
+        KTimerEventLog log;
+        QVERIFY( log.open( m_path, 8 ) );
+        fill( &log, 10 );
+    }
+
+    KTimerEventLog reader;
+    QVERIFY( reader.openReadOnly( m_path ) );
+    QCOMPARE( reader.written(), quint64( 10 ) );
+    QCOMPARE( times( reader.query( 0, 9000, s_forever ) ), QList<qint64>() << 9000 << 10000 );
+
+    // Appending goes on where it was, and the reader sees it in place.
+    KTimerEventLog log;
+    QVERIFY( log.open( m_path, 8 ) );
+    const KTimerEvent event = { 11000, 1, KTimerEvent::Succeeded, 0, 5 };
+    log.append( event );
+    QCOMPARE( times( reader.query( 0, 9000, s_forever ) ), QList<qint64>() << 9000 << 10000 << 11000 );
+
+    // Of another capacity, the log starts afresh.
+    reader.close();
+    log.close();
+    QVERIFY( log.open( m_path, 16 ) );
+    QCOMPARE( log.written(), quint64( 0 ) );
+    QVERIFY( log.query( 0, 0, s_forever ).isEmpty() );
+}
+
+QTEST_GUILESS_MAIN(KTimerEventLogTest)
+
+#include "ktimereventlogtest.moc"
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerringbuffer.h"
+
+#include <QTest>
+
+class KTimerRingBufferTest : public QObject {
+ Q_OBJECT
+
+ private slots:
+    void wraparound();
+    void manySmallAppends();
+    void oversizedAppend();
+    void zeroCapacity();
+    void clear();
+};
+
+
+void KTimerRingBufferTest::wraparound()
+{
+    KTimerRingBuffer ring( 8 );
+    ring.append( "abcdef", 6 );
+    QCOMPARE( ring.toByteArray(), QByteArray( "abcdef" ) );
+    QCOMPARE( ring.dropped(), qint64( 0 ) );
+
+    // Two bytes fit at the end, three go to the front, pushing out "abc".
+    ring.append( "ghijk", 5 );
+    QCOMPARE( ring.size(), 8 );
+    QCOMPARE( ring.toByteArray(), QByteArray( "defghijk" ) );
+    QCOMPARE( ring.dropped(), qint64( 3 ) );
+
+    ring.append( "lm", 2 );
+    QCOMPARE( ring.toByteArray(), QByteArray( "fghijklm" ) );
+    QCOMPARE( ring.dropped(), qint64( 5 ) );
+}
+
+
+void KTimerRingBufferTest::manySmallAppends()
+{
+    KTimerRingBuffer ring( 5 );
+    QByteArray all;
+    for( int i=0; i<23; ++i ) {
+        const char c = 'a' + i;
+        ring.append( &c, 1 );
+        all.append( c );
+        QCOMPARE( ring.toByteArray(), all.right( 5 ) );
+    }
+    QCOMPARE( ring.dropped(), qint64( 23-5 ) );
+}
+
+
+void KTimerRingBufferTest::oversizedAppend()
+{
+    KTimerRingBuffer ring( 4 );
+    ring.append( "xy", 2 );
+    ring.append( "0123456789", 10 );
+    QCOMPARE( ring.toByteArray(), QByteArray( "6789" ) );
+    QCOMPARE( ring.dropped(), qint64( 8 ) );
+
+    // And from there on it wraps as usual.
+    ring.append( "ab", 2 );
+    QCOMPARE( ring.toByteArray(), QByteArray( "89ab" ) );
+}
+
+
+void KTimerRingBufferTest::zeroCapacity()
+{
+    KTimerRingBuffer ring;
+    ring.append( "abc", 3 );
+    QVERIFY( ring.isEmpty() );
+    QCOMPARE( ring.toByteArray(), QByteArray() );
+    QCOMPARE( ring.dropped(), qint64( 3 ) );
+}
+
+
+void KTimerRingBufferTest::clear()
+{
+    KTimerRingBuffer ring( 4 );
+    ring.append( "abcdef", 6 );
+    ring.clear();
+    QVERIFY( ring.isEmpty() );
+    QCOMPARE( ring.dropped(), qint64( 0 ) );
+
+    ring.append( "gh", 2 );
+    QCOMPARE( ring.toByteArray(), QByteArray( "gh" ) );
+
+    // A new capacity starts afresh.
+    ring.setCapacity( 3 );
+    QVERIFY( ring.isEmpty() );
+    ring.append( "ijkl", 4 );
+    QCOMPARE( ring.toByteArray(), QByteArray( "jkl" ) );
+}
+
+QTEST_GUILESS_MAIN(KTimerRingBufferTest)
+
+#include "ktimerringbuffertest.moc"
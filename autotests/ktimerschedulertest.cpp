@@ -0,0 +1,384 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * The scheduler and the jobs on a virtual clock, with a launcher that only
+ * notes what would have been run; like ktimer_sim, but checking the outcome.
+ */
+
+#include "ktimer.h"
+#include "ktimergroup.h"
+#include "ktimerprocess.h"
+#include "ktimerscheduler.h"
+
+#include <time.h>
+
+#include <QPointer>
+#include <QStringList>
+#include <QTest>
+#include <KConfig>
+#include <KConfigGroup>
+
+class TestClock : public KTimerClock {
+ public:
+    TestClock() : m_now( 0 ) {}
+    qint64 now() const Q_DECL_OVERRIDE { return m_now; }
+    void advance( qint64 msec ) { m_now += msec; }
+    void advanceTo( qint64 msec ) { m_now = qMax( m_now, msec ); }
+
+ private:
+    qint64 m_now;
+};
+
+
+// The commands run until finishAll().
+class TestLauncher : public KTimerLauncher {
+ public:
+    bool launch( KTimerProcess *proc, const QString &command ) Q_DECL_OVERRIDE
+    {
+        commands.append( command );
+        m_running.append( proc );
+        return true;
+    }
+
+    void finishAll()
+    {
+        const QList<QPointer<KTimerProcess> > running = m_running;
+        m_running.clear();
+        for( int i=0; i<running.count(); ++i ) {
+            if( running.at( i ) )
+                running.at( i )->setFinished( 0, QProcess::NormalExit, KTimerUsage() );
+        }
+        QCoreApplication::sendPostedEvents( 0, QEvent::DeferredDelete );
+    }
+
+    QStringList commands;
+
+ private:
+    QList<QPointer<KTimerProcess> > m_running;
+};
+
+
+class KTimerSchedulerTest : public QObject {
+ Q_OBJECT
+
+ private slots:
+    void initTestCase();
+    void cleanup();
+
+    void coalescing();
+    void priorities();
+    void groupPause();
+    void groupStop();
+    void catchUpPolicies_data();
+    void catchUpPolicies();
+    void catchUpBusy();
+    void catchUpDropped();
+
+ private:
+    KTimerJob *newJob( const QString &command, unsigned value, unsigned slack=0 );
+    // A looping job of a minute that last ran out ten and a half minutes ago.
+    KTimerJob *lateJob( KTimerJob::CatchUp catchUp, const QString &group=QString() );
+    // Wakes the scheduler whenever it asks to, up to 'time'.
+    void runUntil( qint64 time );
+    void catchUpNext();
+
+    TestClock m_clock;
+    TestLauncher m_launcher;
+    QList<KTimerJob *> m_jobs;
+};
+
+
+void KTimerSchedulerTest::initTestCase()
+{
+    KTimerScheduler::self()->setClock( &m_clock );
+    KTimerProcess::setLauncher( &m_launcher );
+}
+
+
+void KTimerSchedulerTest::cleanup()
+{
+    m_launcher.finishAll();
+    m_launcher.commands.clear();
+    qDeleteAll( m_jobs );
+    m_jobs.clear();
+
+    // Runs owed to deleted jobs are dropped.
+    catchUpNext();
+    QCOMPARE( KTimerScheduler::self()->pendingCatchUps(), 0 );
+    QCOMPARE( KTimerScheduler::self()->count(), 0 );
+}
+
+
+KTimerJob *KTimerSchedulerTest::newJob( const QString &command, unsigned value, unsigned slack )
+{
+    KTimerJob *job = new KTimerJob;
+    job->setCaptureSize( 0 );
+    job->setCommand( command );
+    job->setSlack( slack );
+    job->setValue( value );
+    m_jobs.append( job );
+    return job;
+}
+
+
+KTimerJob *KTimerSchedulerTest::lateJob( KTimerJob::CatchUp catchUp, const QString &group )
+{
+    KConfig cfg( QString(), KConfig::SimpleConfig );
+    KConfigGroup groupcfg = cfg.group( "Job0" );
+    groupcfg.writeEntry( "Delay", 60 );
+    groupcfg.writePathEntry( "Command", QStringLiteral( "late" ) );
+    groupcfg.writeEntry( "Loop", true );
+    groupcfg.writeEntry( "CaptureSize", 0 );
+    groupcfg.writeEntry( "CatchUp", (int)catchUp );
+    groupcfg.writeEntry( "MaxCatchUp", 3 );
+    groupcfg.writeEntry( "Group", group );
+    groupcfg.writeEntry( "State", (int)KTimerJob::Started );
+    // Eleven expiries missed, whether or not the second ticks meanwhile.
+    groupcfg.writeEntry( "Expires", (qint64)time( NULL ) - 630 );
+
+    KTimerJob *job = new KTimerJob;
+    m_jobs.append( job );
+    job->load( &cfg, QStringLiteral( "Job0" ) );
+    return job;
+}
+
+
+void KTimerSchedulerTest::runUntil( qint64 time )
+{
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+    while( scheduler->nextWakeup()>=0 && scheduler->nextWakeup()<=time ) {
+        m_clock.advanceTo( scheduler->nextWakeup() );
+        scheduler->wakeup();
+    }
+    m_clock.advanceTo( time );
+}
+
+
+void KTimerSchedulerTest::catchUpNext()
+{
+    QMetaObject::invokeMethod( KTimerScheduler::self(), "catchUpNext" );
+}
+
+
+// Jobs whose windows overlap share a wakeup; the others wait for theirs.
+void KTimerSchedulerTest::coalescing()
+{
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+    const qint64 t0 = m_clock.now();
+
+    KTimerJob *sharp = newJob( QStringLiteral( "sharp" ), 10 );             // at 10 s
+    KTimerJob *loose = newJob( QStringLiteral( "loose" ), 12, 5 );          // from 7 s to 17 s
+    KTimerJob *later = newJob( QStringLiteral( "later" ), 30, 5 );          // from 25 s to 35 s
+    sharp->start();
+    loose->start();
+    later->start();
+    QCOMPARE( scheduler->nextWakeup(), t0 + 10000 );
+
+    const quint64 wakeups = scheduler->wakeups();
+    runUntil( t0 + 20000 );
+    QCOMPARE( scheduler->wakeups(), wakeups + 1 );
+    QCOMPARE( m_launcher.commands, QStringList() << QStringLiteral( "sharp" ) << QStringLiteral( "loose" ) );
+    QCOMPARE( sharp->state(), KTimerJob::Stopped );
+    QCOMPARE( loose->state(), KTimerJob::Stopped );
+
+    // Alone, a job is woken for at the start of its window.
+    QVERIFY( scheduler->isScheduled( later ) );
+    QCOMPARE( scheduler->nextWakeup(), t0 + 25000 );
+    runUntil( t0 + 40000 );
+    QCOMPARE( scheduler->wakeups(), wakeups + 2 );
+    QCOMPARE( m_launcher.commands.count(), 3 );
+}
+
+
+// The jobs of one wakeup start by priority first, deadline second.
+void KTimerSchedulerTest::priorities()
+{
+    const qint64 t0 = m_clock.now();
+
+    KTimerJob *low = newJob( QStringLiteral( "low" ), 5 );
+    low->setPriority( KTimerJob::LowPriority );
+    KTimerJob *normal = newJob( QStringLiteral( "normal" ), 6, 2 );
+    KTimerJob *early = newJob( QStringLiteral( "early" ), 4, 2 );
+    KTimerJob *high = newJob( QStringLiteral( "high" ), 7, 2 );
+    high->setPriority( KTimerJob::HighPriority );
+    low->start();
+    normal->start();
+    early->start();
+    high->start();
+
+    const quint64 wakeups = KTimerScheduler::self()->wakeups();
+    runUntil( t0 + 10000 );
+    QCOMPARE( KTimerScheduler::self()->wakeups(), wakeups + 1 );
+    QCOMPARE( m_launcher.commands, QStringList() << QStringLiteral( "high" ) << QStringLiteral( "early" )
+                                                 << QStringLiteral( "normal" ) << QStringLiteral( "low" ) );
+}
+
+
+// A paused group keeps its countdowns and costs no wakeups.
+void KTimerSchedulerTest::groupPause()
+{
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+    KTimerGroup *group = KTimerGroup::group( QStringLiteral( "pause" ) );
+    const qint64 t0 = m_clock.now();
+
+    KTimerJob *job = newJob( QStringLiteral( "paused" ), 10 );
+    job->setGroup( group->name() );
+    job->start();
+    QCOMPARE( scheduler->nextWakeup(), t0 + 10000 );
+
+    m_clock.advance( 4000 );
+    group->pause();
+    QCOMPARE( scheduler->nextWakeup(), qint64( -1 ) );
+    QCOMPARE( scheduler->expiry( job ), qint64( -1 ) );
+
+    runUntil( t0 + 60000 );
+    QVERIFY( m_launcher.commands.isEmpty() );
+    QCOMPARE( job->state(), KTimerJob::Started );
+    QCOMPARE( job->value(), 6u );
+
+    // The countdown goes on from where it stood.
+    group->resume();
+    QCOMPARE( scheduler->nextWakeup(), t0 + 66000 );
+    QCOMPARE( scheduler->expiry( job ), t0 + 66000 );
+    runUntil( t0 + 70000 );
+    QCOMPARE( m_launcher.commands, QStringList() << QStringLiteral( "paused" ) );
+}
+
+
+// Stopping a group stops its started and paused jobs, and no others.
+void KTimerSchedulerTest::groupStop()
+{
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+    KTimerGroup *group = KTimerGroup::group( QStringLiteral( "stop" ) );
+    const qint64 t0 = m_clock.now();
+
+    KTimerJob *started = newJob( QStringLiteral( "started" ), 10 );
+    started->setGroup( group->name() );
+    started->setDelay( 30u );
+    started->setValue( 10u );
+    started->start();
+    KTimerJob *paused = newJob( QStringLiteral( "paused" ), 10 );
+    paused->setGroup( group->name() );
+    paused->start();
+    paused->pause();
+    KTimerJob *other = newJob( QStringLiteral( "other" ), 10 );
+    other->start();
+
+    group->stop();
+
+    // Before anybody looked at the jobs themselves.
+    QCOMPARE( KTimerJob::jobs( KTimerJob::Started ), QList<KTimerJob *>() << other );
+    QVERIFY( KTimerJob::jobs( KTimerJob::Paused ).isEmpty() );
+    QCOMPARE( KTimerJob::jobs( KTimerJob::Stopped ).count(), 2 );
+
+    QVERIFY( !scheduler->isScheduled( started ) );
+    QCOMPARE( started->state(), KTimerJob::Stopped );
+    QCOMPARE( started->value(), 30u );
+    QCOMPARE( paused->state(), KTimerJob::Stopped );
+    QVERIFY( !group->isPaused() );
+
+    runUntil( t0 + 30000 );
+    QCOMPARE( m_launcher.commands, QStringList() << QStringLiteral( "other" ) );
+
+    // The group runs on as before.
+    started->start();
+    QCOMPARE( scheduler->expiry( started ), m_clock.now() + 30000 );
+}
+
+
+void KTimerSchedulerTest::catchUpPolicies_data()
+{
+    QTest::addColumn<int>( "catchUp" );
+    QTest::addColumn<int>( "runs" );
+
+    QTest::newRow( "once" ) << (int)KTimerJob::CatchUpOnce << 1;
+    QTest::newRow( "all, at most three" ) << (int)KTimerJob::CatchUpAll << 3;
+    QTest::newRow( "skip" ) << (int)KTimerJob::CatchUpSkip << 0;
+    QTest::newRow( "restart" ) << (int)KTimerJob::CatchUpRestart << 0;
+}
+
+
+void KTimerSchedulerTest::catchUpPolicies()
+{
+    QFETCH( int, catchUp );
+    QFETCH( int, runs );
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+
+    KTimerJob *job = lateJob( (KTimerJob::CatchUp)catchUp );
+    QCOMPARE( scheduler->pendingCatchUps(), runs );
+    QCOMPARE( job->state(), KTimerJob::Started );
+    QVERIFY( scheduler->isScheduled( job ) );
+    if( catchUp==KTimerJob::CatchUpRestart )
+        QCOMPARE( job->value(), 60u );
+
+    // One run a tick, nothing started at load time.
+    QVERIFY( m_launcher.commands.isEmpty() );
+    for( int i=0; i<runs; ++i ) {
+        catchUpNext();
+        QCOMPARE( m_launcher.commands.count(), i+1 );
+        m_launcher.finishAll();
+    }
+    QCOMPARE( scheduler->pendingCatchUps(), 0 );
+}
+
+
+// A oneInstance job still running its last run is not owed one less.
+void KTimerSchedulerTest::catchUpBusy()
+{
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+    lateJob( KTimerJob::CatchUpAll );
+    QCOMPARE( scheduler->pendingCatchUps(), 3 );
+
+    catchUpNext();
+    QCOMPARE( m_launcher.commands.count(), 1 );
+    QCOMPARE( scheduler->pendingCatchUps(), 2 );
+
+    catchUpNext();
+    QCOMPARE( m_launcher.commands.count(), 1 );
+    QCOMPARE( scheduler->pendingCatchUps(), 2 );
+
+    m_launcher.finishAll();
+    catchUpNext();
+    QCOMPARE( m_launcher.commands.count(), 2 );
+    QCOMPARE( scheduler->pendingCatchUps(), 1 );
+}
+
+
+// Runs are dropped once the user stops the job, or its group is paused.
+void KTimerSchedulerTest::catchUpDropped()
+{
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+    KTimerGroup *group = KTimerGroup::group( QStringLiteral( "catchup" ) );
+
+    KTimerJob *stopped = lateJob( KTimerJob::CatchUpAll );
+    lateJob( KTimerJob::CatchUpAll, group->name() );
+    QCOMPARE( scheduler->pendingCatchUps(), 6 );
+
+    stopped->stop();
+    group->pause();
+    catchUpNext();
+    QVERIFY( m_launcher.commands.isEmpty() );
+    QCOMPARE( scheduler->pendingCatchUps(), 0 );
+
+    group->resume();
+}
+
+QTEST_GUILESS_MAIN(KTimerSchedulerTest)
+
+#include "ktimerschedulertest.moc"
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimersnapshot.h"
+
+#include <string.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+class KTimerSnapshotTest : public QObject {
+ Q_OBJECT
+
+ private slots:
+    void init();
+    void roundTrip();
+    void staleStamp();
+    void damaged_data();
+    void damaged();
+    void truncated();
+    void missing();
+
+ private:
+    // Two jobs sharing their command.
+    bool write( quint64 stamp );
+
+    QTemporaryDir m_dir;
+    QString m_path;
+};
+
+
+void KTimerSnapshotTest::init()
+{
+    QVERIFY( m_dir.isValid() );
+    m_path = m_dir.path() + QStringLiteral( "/jobs.snapshot" );
+    QFile::remove( m_path );
+}
+
+
+bool KTimerSnapshotTest::write( quint64 stamp )
+{
+    KTimerSnapshotWriter writer;
+
+    KTimerSnapshot::Entry entry;
+    memset( &entry, 0, sizeof( entry ) );
+    QString strings[KTimerSnapshot::StringCount];
+    strings[KTimerSnapshot::Command] = QStringLiteral( "backup --all" );
+
+    entry.id = 1;
+    entry.delay = 60;
+    entry.flags = KTimerSnapshot::Loop;
+    strings[KTimerSnapshot::Group] = QStringLiteral( "nightly" );
+    writer.add( entry, strings );
+
+    entry.id = 2;
+    entry.delay = 3600;
+    entry.flags = KTimerSnapshot::OneInstance;
+    entry.state = 2;
+    entry.expires = 1234567890;
+    strings[KTimerSnapshot::Group] = QString();
+    strings[KTimerSnapshot::CommandUsage] = QStringLiteral( "1 2 3 5 4 6 2 3 5 4 6" );
+    writer.add( entry, strings );
+
+    return writer.write( m_path, stamp );
+}
+
+
+void KTimerSnapshotTest::roundTrip()
+{
+    QVERIFY( write( 42 ) );
+
+    KTimerSnapshot snapshot;
+    QVERIFY( snapshot.open( m_path, 42 ) );
+    QCOMPARE( snapshot.count(), 2 );
+
+    QCOMPARE( snapshot.entry( 0 ).id, quint32( 1 ) );
+    QCOMPARE( snapshot.entry( 0 ).delay, quint32( 60 ) );
+    QCOMPARE( snapshot.entry( 0 ).flags, quint32( KTimerSnapshot::Loop ) );
+    QCOMPARE( snapshot.string( 0, KTimerSnapshot::Command ), QStringLiteral( "backup --all" ) );
+    QCOMPARE( snapshot.string( 0, KTimerSnapshot::Group ), QStringLiteral( "nightly" ) );
+    QCOMPARE( snapshot.string( 0, KTimerSnapshot::CommandUsage ), QString() );
+
+    QCOMPARE( snapshot.entry( 1 ).id, quint32( 2 ) );
+    QCOMPARE( snapshot.entry( 1 ).delay, quint32( 3600 ) );
+    QCOMPARE( snapshot.entry( 1 ).state, 2 );
+    QCOMPARE( snapshot.entry( 1 ).expires, qint64( 1234567890 ) );
+    QCOMPARE( snapshot.string( 1, KTimerSnapshot::Command ), QStringLiteral( "backup --all" ) );
+    QCOMPARE( snapshot.string( 1, KTimerSnapshot::Group ), QString() );
+    QCOMPARE( snapshot.string( 1, KTimerSnapshot::CommandUsage ), QStringLiteral( "1 2 3 5 4 6 2 3 5 4 6" ) );
+}
+
+
+void KTimerSnapshotTest::staleStamp()
+{
+    QVERIFY( write( 42 ) );
+
+    KTimerSnapshot snapshot;
+    QVERIFY( !snapshot.open( m_path, 41 ) );
+    QCOMPARE( snapshot.count(), 0 );
+}
+
+
+void KTimerSnapshotTest::damaged_data()
+{
+    QTest::addColumn<int>( "from" );        // the byte flipped, counted from the end of the file
+
+    QTest::newRow( "string area" ) << 1;
+    QTest::newRow( "last entry" ) << 100;
+    QTest::newRow( "first entry" ) << 250;
+}
+
+
+// Every byte after the header counts towards the checksum.
+void KTimerSnapshotTest::damaged()
+{
+    QFETCH( int, from );
+    QVERIFY( write( 42 ) );
+
+    QFile file( m_path );
+    QVERIFY( file.open( QIODevice::ReadWrite ) );
+    QVERIFY( file.size()>=from );
+    QVERIFY( file.seek( file.size()-from ) );
+    char byte;
+    QVERIFY( file.getChar( &byte ) );
+    QVERIFY( file.seek( file.size()-from ) );
+    QVERIFY( file.putChar( byte ^ 0x10 ) );
+    file.close();
+
+    KTimerSnapshot snapshot;
+    QVERIFY( !snapshot.open( m_path, 42 ) );
+    QCOMPARE( snapshot.count(), 0 );
+}
+
+
+void KTimerSnapshotTest::truncated()
+{
+    QVERIFY( write( 42 ) );
+
+    QFile file( m_path );
+    QVERIFY( file.resize( file.size()-1 ) );
+
+    KTimerSnapshot snapshot;
+    QVERIFY( !snapshot.open( m_path, 42 ) );
+
+    QVERIFY( file.resize( 10 ) );
+    QVERIFY( !snapshot.open( m_path, 42 ) );
+}
+
+
+void KTimerSnapshotTest::missing()
+{
+    KTimerSnapshot snapshot;
+    QVERIFY( !snapshot.open( m_path, 42 ) );
+}
+
+QTEST_GUILESS_MAIN(KTimerSnapshotTest)
+
+#include "ktimersnapshottest.moc"
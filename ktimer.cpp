@@ -17,23 +17,60 @@
  */
 
 #include "ktimer.h"
-
+#include "ktimerbatch.h"
+#include "ktimercoprocess.h"
+#include "ktimer_debug.h"
+#include "ktimergroup.h"
+#include "ktimerjobindex.h"
+#include "ktimerjobstore.h"
+#include "ktimerprocess.h"
+#include "ktimerringbuffer.h"
+#include "ktimerscheduler.h"
+#include "ktimersnapshot.h"
+#include "ktimerusage.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
 #include <time.h>
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
 
-#include <QProcess>
 #include <QTimer>
+#include <QDialogButtonBox>
+#include <QDateTime>
+#include <QFontDatabase>
+#include <QHash>
+#include <QLabel>
+#include <QLocale>
+#include <QMap>
+#include <QPlainTextEdit>
+#include <QSet>
+#include <QSpinBox>
+#include <QTabWidget>
+#include <QTreeWidget>
+#include <QVBoxLayout>
 #include <KConfigGroup>
+#include <KFormat>
+#include <KLocalizedString>
 #include <klineedit.h>
 #include <ktoolinvocation.h>
 #include <kstandardguiitem.h>
 #include <QAction>
 #include <kstandardaction.h>
-#include "kstatusnotifieritem.h"
 #include <KToolInvocation>
 #include <KHelpClient>
 #include <KGuiItem>
 #include <KSharedConfig>
 
+static QString formatMs( quint32 ms )
+{
+    return i18nc( "a duration in seconds", "%1s", QString::number( ms/1000.0, 'f', ms<10000 ? 2 : 1 ) );
+}
+
 class KTimerJobItem : public QTreeWidgetItem {
 public:
     // NB: 'parent' is 'm_list'
@@ -56,10 +93,6 @@ public:
         update();
     }
 
-    virtual ~KTimerJobItem() {
-        delete m_job;
-    }
-
     KTimerJob *job() { return m_job; }
 
     void setStatus( bool error ) {
@@ -93,7 +126,7 @@ public:
             setIcon( 0, QIcon::fromTheme( QStringLiteral( "process-stop" )) );
         }
         else
-        if ( m_job->state() == KTimerJob::Paused)
+        if ( m_job->state() == KTimerJob::Paused || ( m_job->state() == KTimerJob::Started && !m_job->group()->isRunning() ) )
         {
             setIcon(0, QIcon::fromTheme( QStringLiteral( "media-playback-pause" )));
         }
@@ -112,6 +145,19 @@ public:
         }
 
         setText( 3, m_job->command() );
+
+        // CPU time of the command: median / 95th percentile / maximum
+        const KTimerUsageStats &usage = m_job->commandUsage();
+        if( usage.count() ) {
+            setText( 4, QStringLiteral( "%1 / %2 / %3" )
+                     .arg( formatMs( usage.percentile( KTimerUsageStats::CpuTime, 50 ) ) )
+                     .arg( formatMs( usage.percentile( KTimerUsageStats::CpuTime, 95 ) ) )
+                     .arg( formatMs( usage.maximum( KTimerUsageStats::CpuTime ) ) ) );
+            setToolTip( 4, m_job->usageSummary() );
+        } else {
+            setText( 4, QString() );
+            setToolTip( 4, QString() );
+        }
     }
 
 private:
@@ -125,29 +171,39 @@ private:
 
 struct KTimerPrefPrivate
 {
-    QList<KTimerJob *> jobs;
+    KTimerJobStore *store;
+    QTimer *refresh;
+
+    // The filter bar; while filtered, exactly the rows of 'visible' are shown.
+    KTimerJobIndex *index;
+    KTimerJobIndex::Filter filter;
+    bool filtered;
+    QSet<KTimerJob *> visible;
 };
 
-KTimerPref::KTimerPref( QWidget *parent)
+KTimerPref::KTimerPref( KTimerJobStore *store, QWidget *parent )
     : QDialog( parent )
 {
     d = new KTimerPrefPrivate;
+    d->store = store;
 
     setupUi(this);
 
+    // Running countdowns are only redrawn while somebody can see them.
+    d->refresh = new QTimer( this );
+    connect(d->refresh, &QTimer::timeout, this, &KTimerPref::refresh);
+
+    d->index = new KTimerJobIndex( this );
+    d->filtered = false;
+
+    showSeconds = KSharedConfig::openConfig()->group( "Jobs" ).readEntry( "ShowSeconds", false );
+
     // set icons
     m_stop->setIcon( QIcon::fromTheme( QStringLiteral( "media-playback-stop" )) );
     m_pause->setIcon( QIcon::fromTheme( QStringLiteral( "media-playback-pause" )) );
     m_start->setIcon( QIcon::fromTheme( QStringLiteral( "arrow-right" )) );
 
-    // create tray icon
-    KStatusNotifierItem *tray = new KStatusNotifierItem(this);
-    tray->setIconByName(QStringLiteral( "ktimer" ));
-    tray->setCategory(KStatusNotifierItem::ApplicationStatus);
-    tray->setStatus(KStatusNotifierItem::Active);
-
-	// TODO: Somehow replace the 'are you sure?' nuisance....
-	//KStandardAction::quit(this, SLOT(exit()), tray->d->actionCollection);
+    connect(KTimerGroup::global(), &KTimerGroup::stateChanged, this, &KTimerPref::groupChanged);
 
     // Set initial visibility states & column widths
     m_state->hide();
@@ -170,42 +226,111 @@ KTimerPref::KTimerPref( QWidget *parent)
     connect(m_done, &QPushButton::clicked, this, &KTimerPref::edit);
     connect(m_remove, &QPushButton::clicked, this, &KTimerPref::remove);
     connect(m_help, &QPushButton::clicked, this, &KTimerPref::help);
+    connect(m_showOutput, &QPushButton::clicked, this, &KTimerPref::showOutput);
+    connect(m_upcoming, &QPushButton::clicked, this, &KTimerPref::showUpcoming);
     connect(m_list, &QTreeWidget::currentItemChanged, this, &KTimerPref::currentChanged);
     connect(m_list, &QTreeWidget::itemDoubleClicked, this, &KTimerPref::currentDoubleClicked);
-    loadJobs( KSharedConfig::openConfig().data() );
-
-    show();
+    connect(m_filter, &QLineEdit::textChanged, this, &KTimerPref::filterChanged);
+    connect(m_filterState, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &KTimerPref::filterChanged);
+    connect(m_filterGroup, &QLineEdit::textChanged, this, &KTimerPref::filterChanged);
+
+    // The rows of the jobs there are, and of those to come.
+    m_add->setEnabled( store->isLeader() );
+    m_list->setUpdatesEnabled( false );
+    for( int i=0; i<store->count(); ++i )
+        jobAdded( store->at( i ) );
+    m_list->setUpdatesEnabled( true );
+    connect(store, &KTimerJobStore::jobAdded, this, &KTimerPref::jobAdded);
+    connect(store, &KTimerJobStore::jobRemoved, this, &KTimerPref::jobRemoved);
+    connect(store, &KTimerJobStore::jobReloaded, this, &KTimerPref::jobReloaded);
+    connect(store, &KTimerJobStore::jobsChanged, this, &KTimerPref::jobsChanged);
+    connect(store, &KTimerJobStore::jobFinished, this, &KTimerPref::jobFinished);
+    connect(store, &KTimerJobStore::elected, this, &KTimerPref::leaderElected);
 }
 
 
 KTimerPref::~KTimerPref()
 {
+    // The jobs outlive their rows.
+    for( int i=0; i<d->store->count(); ++i )
+        d->store->at( i )->setUser( 0 );
     delete d;
 }
 
-void KTimerPref::saveAllJobs() {
-    saveJobs( KSharedConfig::openConfig().data() );
+void KTimerPref::showEvent( QShowEvent *event )
+{
+    KTimerScheduler::self()->setInteractive( true );
+    refresh();
+    d->refresh->start( 1000 );
+    QDialog::showEvent( event );
 }
 
+void KTimerPref::hideEvent( QHideEvent *event )
+{
+    d->refresh->stop();
+    KTimerScheduler::self()->setInteractive( false );
+    QDialog::hideEvent( event );
+}
 
-void KTimerPref::add()
+void KTimerPref::refresh()
 {
-    KTimerJob *job = new KTimerJob;
-    KTimerJobItem *item = new KTimerJobItem( job, m_list );
+    // Only the running countdowns move, and only the shown ones need redrawing.
+    const QList<KTimerJob *> started = KTimerJob::jobs( KTimerJob::Started );
+    for( int i=0; i<started.count(); ++i ) {
+        KTimerJobItem *item = static_cast<KTimerJobItem*>(started.at( i )->user());
+        if( item && !item->isHidden() )
+            jobChanged( started.at( i ) );
+    }
+}
 
-    connect(job, &KTimerJob::delayChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::valueChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::stateChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::commandChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::onScheduleChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::onPauseChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::onResumeChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::onStopChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::onSuccessChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::onFailureChanged, this, &KTimerPref::jobChanged);
-    connect(job, &KTimerJob::finished, this, &KTimerPref::jobFinished);
+// The leader went away, the jobs are ours to edit now.
+void KTimerPref::leaderElected()
+{
+    m_add->setEnabled( true );
+    currentChanged( m_list->currentItem(), 0 );
+}
+
+
+// A row at the end of the list, for a job the store already set up.
+void KTimerPref::jobAdded( KTimerJob *job )
+{
+    KTimerJobItem *item = new KTimerJobItem( job, m_list );
+    d->index->add( job );
 
     job->setUser( item );
+    jobGroupChanged( job );
+}
+
+
+void KTimerPref::jobRemoved( KTimerJob *job )
+{
+    d->index->remove( job );
+    d->visible.remove( job );
+    delete static_cast<KTimerJobItem*>(job->user());
+    job->setUser( 0 );
+    m_list->update();
+}
+
+
+void KTimerPref::jobReloaded( KTimerJob *job )
+{
+    KTimerJobItem *item = static_cast<KTimerJobItem*>(job->user());
+    jobChanged( job );
+    if( item && item==m_list->currentItem() )
+        currentChanged( item, nullptr );
+}
+
+
+void KTimerPref::add()
+{
+    KTimerJob *job = d->store->add();
+    KTimerJobItem *item = static_cast<KTimerJobItem*>(job->user());
+
+    // A new job is shown whatever the filter, until it is changed.
+    if( d->filtered ) {
+        item->setHidden( false );
+        d->visible.insert( job );
+    }
 
     // Qt drops currentChanged signals on first item (bug?)
     if( m_list->topLevelItemCount()==1 )
@@ -230,8 +355,9 @@ void KTimerPref::edit()
 
 void KTimerPref::remove()
 {
-    delete m_list->currentItem();
-    m_list->update();
+    KTimerJobItem *item = static_cast<KTimerJobItem*>(m_list->currentItem());
+    if( item )
+        d->store->remove( item->job() );
 }
 
 void KTimerPref::help()
@@ -239,6 +365,130 @@ void KTimerPref::help()
     KHelpClient::invokeHelp();
 }
 
+static QPlainTextEdit *createOutputView( const QByteArray &text, QWidget *parent )
+{
+    QPlainTextEdit *view = new QPlainTextEdit( parent );
+    view->setReadOnly( true );
+    view->setLineWrapMode( QPlainTextEdit::NoWrap );
+    view->setFont( QFontDatabase::systemFont( QFontDatabase::FixedFont ) );
+    view->setPlainText( QString::fromLocal8Bit( text ) );
+    view->moveCursor( QTextCursor::End );
+    return view;
+}
+
+void KTimerPref::showOutput()
+{
+    KTimerJobItem *item = static_cast<KTimerJobItem*>(m_list->currentItem());
+    if( !item )
+        return;
+
+    KTimerJob *job = item->job();
+
+    QDialog *dialog = new QDialog( this );
+    dialog->setAttribute( Qt::WA_DeleteOnClose );
+    dialog->setWindowTitle( i18n( "Output of %1", job->command() ) );
+
+    QTabWidget *tabs = new QTabWidget( dialog );
+    tabs->addTab( createOutputView( job->capturedOutput(), tabs ), i18n( "Standard Output" ) );
+    tabs->addTab( createOutputView( job->capturedErrors(), tabs ), i18n( "Standard Error" ) );
+    if( job->capturedOutput().isEmpty() && !job->capturedErrors().isEmpty() )
+        tabs->setCurrentIndex( 1 );
+
+    QDialogButtonBox *buttons = new QDialogButtonBox( QDialogButtonBox::Close, dialog );
+    connect(buttons, &QDialogButtonBox::rejected, dialog, &QDialog::reject);
+
+    QVBoxLayout *layout = new QVBoxLayout( dialog );
+    layout->addWidget( tabs );
+    layout->addWidget( buttons );
+
+    dialog->resize( 640, 400 );
+    dialog->show();
+}
+
+// Sorts the time columns by time rather than by text.
+class KTimerUpcomingItem : public QTreeWidgetItem {
+ public:
+    explicit KTimerUpcomingItem( QTreeWidget *parent ) : QTreeWidgetItem( parent ) {}
+
+    bool operator<( const QTreeWidgetItem &other ) const Q_DECL_OVERRIDE
+    {
+        const int column = treeWidget() ? treeWidget()->sortColumn() : 0;
+        if( column<2 )
+            return data( 0, Qt::UserRole ).toLongLong() < other.data( 0, Qt::UserRole ).toLongLong();
+        return QTreeWidgetItem::operator<( other );
+    }
+};
+
+
+void KTimerPref::showUpcoming()
+{
+    QDialog *dialog = new QDialog( this );
+    dialog->setAttribute( Qt::WA_DeleteOnClose );
+    dialog->setWindowTitle( i18n( "Next Due" ) );
+
+    QSpinBox *within = new QSpinBox( dialog );
+    within->setRange( 1, 7*24*60 );
+    within->setValue( 60 );
+    within->setSuffix( i18n( " min" ) );
+
+    QTreeWidget *view = new QTreeWidget( dialog );
+    view->setRootIsDecorated( false );
+    view->setAllColumnsShowFocus( true );
+    view->setHeaderLabels( QStringList() << i18n( "Due" ) << i18n( "In" ) << i18n( "Command" ) );
+    view->setSortingEnabled( true );
+    view->sortByColumn( 1, Qt::AscendingOrder );
+
+    // The scheduler hands out the due jobs in order, so this only costs what is shown.
+    auto fill = [this, view, within]() {
+        KTimerScheduler *scheduler = KTimerScheduler::self();
+        const QList<KTimerJob *> jobs = scheduler->upcoming( within->value()*60000LL, 1000 );
+        const QDateTime now = QDateTime::currentDateTime();
+        const qint64 monotonic = scheduler->now();
+
+        view->setUpdatesEnabled( false );
+        view->clear();
+        for( int i=0; i<jobs.count(); ++i ) {
+            KTimerJob *job = jobs.at( i );
+            const qint64 in = qMax<qint64>( 0, scheduler->expiry( job ) - monotonic );
+            KTimerUpcomingItem *item = new KTimerUpcomingItem( view );
+            item->setData( 0, Qt::UserRole, in );
+            item->setData( 1, Qt::UserRole, job->id() );
+            item->setText( 0, QLocale().toString( now.addMSecs( in ).time(), QLocale::ShortFormat ) );
+            item->setText( 1, job->formatTime( ( in+999 ) / 1000 ) );
+            item->setText( 2, job->command() );
+        }
+        view->setUpdatesEnabled( true );
+    };
+    fill();
+
+    connect(within, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), view, fill);
+
+    connect(view, &QTreeWidget::itemDoubleClicked, this, [this](QTreeWidgetItem *item) {
+        KTimerJob *job = KTimerJob::find( item->data( 1, Qt::UserRole ).toUInt() );
+        if( job && job->user() )
+            m_list->setCurrentItem( static_cast<KTimerJobItem*>(job->user()) );
+    });
+
+    QDialogButtonBox *buttons = new QDialogButtonBox( QDialogButtonBox::Close, dialog );
+    connect(buttons, &QDialogButtonBox::rejected, dialog, &QDialog::reject);
+    QPushButton *refresh = buttons->addButton( i18n( "&Refresh" ), QDialogButtonBox::ActionRole );
+    connect(refresh, &QPushButton::clicked, view, fill);
+
+    QHBoxLayout *top = new QHBoxLayout;
+    top->addWidget( new QLabel( i18n( "Running out within:" ), dialog ) );
+    top->addWidget( within );
+    top->addStretch();
+
+    QVBoxLayout *layout = new QVBoxLayout( dialog );
+    layout->addLayout( top );
+    layout->addWidget( view );
+    layout->addWidget( buttons );
+
+    dialog->resize( 520, 400 );
+    dialog->show();
+}
+
+
 // note, don't use old, but added it so we can connect to the new one
 void KTimerPref::currentChanged( QTreeWidgetItem *i , QTreeWidgetItem * /* old */)
 {
@@ -246,15 +496,26 @@ void KTimerPref::currentChanged( QTreeWidgetItem *i , QTreeWidgetItem * /* old *
     if( item ) {
         KTimerJob *job = item->job();
 
-        m_state->setEnabled( true );
-        m_settings->setEnabled( true );
-        m_remove->setEnabled( true );
+        const bool writable = d->store->isLeader();
+        m_state->setEnabled( writable );
+        m_settings->setEnabled( writable );
+        m_remove->setEnabled( writable );
+        m_showOutput->setEnabled( true );
         m_delayH->disconnect();
         m_delayM->disconnect();
         m_delay->disconnect();
+        m_slack->disconnect();
+        m_maxRuntime->disconnect();
+        m_priority->disconnect();
+        m_catchUp->disconnect();
+        m_maxCatchUp->disconnect();
+        m_group->disconnect();
         m_loop->disconnect();
         m_one->disconnect();
         m_consecutive->disconnect();
+        m_batch->disconnect();
+        m_coprocess->disconnect();
+        m_pipeOutput->disconnect();
         m_start->disconnect();
         m_pause->disconnect();
         m_stop->disconnect();
@@ -281,6 +542,13 @@ void KTimerPref::currentChanged( QTreeWidgetItem *i , QTreeWidgetItem * /* old *
         m_delayH->setValue( h );
         m_delayM->setValue( m );
         m_delay->setValue( s );
+        m_slack->setValue( job->slack() );
+        m_maxRuntime->setValue( job->maxRuntime() );
+        m_priority->setCurrentIndex( job->priority() );
+        m_catchUp->setCurrentIndex( job->catchUp() );
+        m_maxCatchUp->setValue( job->maxCatchUp() );
+        m_maxCatchUp->setEnabled( job->catchUp()==KTimerJob::CatchUpAll );
+        m_group->setText( job->group()->name() );
 
         connect( m_commandLine->lineEdit(), SIGNAL(textChanged(QString)), job, SLOT(setCommand(QString)) );
         connect( m_onSchedule->lineEdit(), SIGNAL(textChanged(QString)), job, SLOT(setOnSchedule(QString)) );
@@ -293,9 +561,21 @@ void KTimerPref::currentChanged( QTreeWidgetItem *i , QTreeWidgetItem * /* old *
         connect(m_delayH, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KTimerPref::delayChanged);
         connect(m_delayM, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KTimerPref::delayChanged);
         connect(m_delay, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &KTimerPref::delayChanged);
+        connect(m_slack, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), job, [job](int sec) { job->setSlack( sec ); });
+        connect(m_maxRuntime, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), job, [job](int sec) { job->setMaxRuntime( sec ); });
+        connect(m_priority, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), job, [job](int index) { job->setPriority( (KTimerJob::Priority)index ); });
+        connect(m_catchUp, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), job, [this, job](int index) {
+            job->setCatchUp( (KTimerJob::CatchUp)index );
+            m_maxCatchUp->setEnabled( index==KTimerJob::CatchUpAll );
+        });
+        connect(m_maxCatchUp, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), job, [job](int runs) { job->setMaxCatchUp( runs ); });
+        connect(m_group, &QLineEdit::editingFinished, job, [this, job]() { job->setGroup( m_group->text().trimmed() ); });
         connect(m_loop, &QCheckBox::toggled, job, &KTimerJob::setLoop);
         connect(m_one, &QCheckBox::toggled, job, &KTimerJob::setOneInstance);
         connect(m_consecutive, &QCheckBox::toggled, job, &KTimerJob::setConsecutive);
+        connect(m_batch, &QCheckBox::toggled, job, &KTimerJob::setBatch);
+        connect(m_coprocess, &QCheckBox::toggled, job, &KTimerJob::setCoprocess);
+        connect(m_pipeOutput, &QCheckBox::toggled, job, &KTimerJob::setPipeOutput);
         connect(m_stop, &QToolButton::clicked, job, &KTimerJob::stop);
         connect(m_pause, &QToolButton::clicked, job, &KTimerJob::pause);
         connect(m_start, &QToolButton::clicked, job, &KTimerJob::start);
@@ -313,6 +593,9 @@ void KTimerPref::currentChanged( QTreeWidgetItem *i , QTreeWidgetItem * /* old *
         m_loop->setChecked( job->loop() );
         m_one->setChecked( job->oneInstance() );
         m_consecutive->setChecked( job->consecutive() );
+        m_batch->setChecked( job->batch() );
+        m_coprocess->setChecked( job->coprocess() );
+        m_pipeOutput->setChecked( job->pipeOutput() );
         m_counter->display( (int)job->value() );
         m_slider->setMaximum( job->delay() );
         m_slider->setValue( job->value() );
@@ -321,6 +604,7 @@ void KTimerPref::currentChanged( QTreeWidgetItem *i , QTreeWidgetItem * /* old *
         m_state->setEnabled( false );
         m_settings->setEnabled( false );
         m_remove->setEnabled( false );
+        m_showOutput->setEnabled( false );
     }
 }
 
@@ -370,14 +654,120 @@ void KTimerPref::jobChanged( KTimerJob *job )
 }
 
 
+void KTimerPref::jobsChanged( const QHash<KTimerJob *, KTimerJob::Fields> &changes )
+{
+    for( QHash<KTimerJob *, KTimerJob::Fields>::const_iterator it = changes.constBegin(); it != changes.constEnd(); ++it ) {
+        KTimerJob *job = it.key();
+        if( it.value() & ( KTimerJob::Command | KTimerJob::Group ) )
+            d->index->update( job );
+
+        if( it.value() & KTimerJob::Group )
+            jobGroupChanged( job );
+        else if( it.value() & ( KTimerJob::State | KTimerJob::Command ) ) {
+            jobMatchChanged( job );
+            jobChanged( job );
+        } else
+            jobChanged( job );
+    }
+}
+
+
+void KTimerPref::jobGroupChanged( KTimerJob *job )
+{
+    connect(job->group(), &KTimerGroup::stateChanged, this, &KTimerPref::groupChanged, Qt::UniqueConnection);
+    jobMatchChanged( job );
+    jobChanged( job );
+}
+
+
+// A job changed in a way the filter may care about.
+void KTimerPref::jobMatchChanged( KTimerJob *job )
+{
+    KTimerJobItem *item = static_cast<KTimerJobItem*>(job->user());
+    if( !d->filtered || !item )
+        return;
+
+    const bool match = d->index->matches( job, d->filter );
+    item->setHidden( !match );
+    if( match )
+        d->visible.insert( job );
+    else
+        d->visible.remove( job );
+}
+
+
+void KTimerPref::filterChanged()
+{
+    KTimerJobIndex::Filter filter;
+    filter.text = m_filter->text();
+    filter.state = m_filterState->currentIndex() - 1;     // "Any state", then KTimerJob::States
+    if( !m_filterGroup->text().trimmed().isEmpty() )
+        filter.group = m_filterGroup->text().trimmed();
+    d->filter = filter;
+
+    m_list->setUpdatesEnabled( false );
+    if( filter.isEmpty() ) {
+        if( d->filtered ) {
+            const int nbList=m_list->topLevelItemCount();
+            for (int num = 0; num < nbList; ++num)
+                m_list->topLevelItem(num)->setHidden( false );
+        }
+        d->filtered = false;
+        d->visible.clear();
+    } else {
+        const QVector<KTimerJob *> found = d->index->find( filter );
+        QSet<KTimerJob *> visible;
+        visible.reserve( found.count() );
+        for( int i=0; i<found.count(); ++i )
+            visible.insert( found.at( i ) );
+
+        if( !d->filtered ) {
+            // Going from everything to a few: every row has to go once.
+            const int nbList=m_list->topLevelItemCount();
+            for (int num = 0; num < nbList; ++num) {
+                KTimerJobItem *item = static_cast<KTimerJobItem*>(m_list->topLevelItem(num));
+                item->setHidden( !visible.contains( item->job() ) );
+            }
+        } else {
+            // Refining or widening: only the rows that come or go.
+            for( QSet<KTimerJob *>::const_iterator it = d->visible.constBegin(); it != d->visible.constEnd(); ++it ) {
+                if( !visible.contains( *it ) && (*it)->user() )
+                    static_cast<KTimerJobItem*>((*it)->user())->setHidden( true );
+            }
+            for( QSet<KTimerJob *>::const_iterator it = visible.constBegin(); it != visible.constEnd(); ++it ) {
+                if( !d->visible.contains( *it ) && (*it)->user() )
+                    static_cast<KTimerJobItem*>((*it)->user())->setHidden( false );
+            }
+        }
+        d->filtered = true;
+        d->visible = visible;
+    }
+    m_list->setUpdatesEnabled( true );
+}
+
+
+void KTimerPref::groupChanged( KTimerGroup *group )
+{
+    // Pausing or stopping a group does not touch its jobs, so they never told us.
+    const int nbList=m_list->topLevelItemCount();
+    for (int num = 0; num < nbList; ++num)
+    {
+        KTimerJobItem *item = static_cast<KTimerJobItem*>(m_list->topLevelItem(num));
+        if( group->isGlobal() || item->job()->group()==group )
+            jobChanged( item->job() );
+    }
+}
+
+
 void KTimerPref::jobFinished( KTimerJob *job, bool error )
 {
     KTimerJobItem *item = static_cast<KTimerJobItem*>(job->user());
     item->setStatus( error );
-    if( m_list->itemBelow(m_list->currentItem())!=nullptr && (static_cast<KTimerJobItem*>(m_list->itemBelow( m_list->currentItem() )))->job()->consecutive() ) {
-        m_list->setCurrentItem( m_list->itemBelow( m_list->currentItem() ) );
-        (static_cast<KTimerJobItem*>(m_list->currentItem()))->job()->start();
-    }
+
+    // The store started the next job already if it follows this one; follow it.
+    KTimerJobItem *below = static_cast<KTimerJobItem*>(m_list->itemBelow( item ));
+    if( item==m_list->currentItem() && below && below->job()->consecutive() )
+        m_list->setCurrentItem( below );
     m_list->update();
 }
 
@@ -414,64 +804,15 @@ void KTimerPref::exit() {
 }
 
 void KTimerPref::done(int result) {
-    saveAllJobs();
+    d->store->saveAll();
     QDialog::done(result);
 }
 
-void KTimerPref::saveJobs( KConfig *cfg )
-{
-	const int nbList=m_list->topLevelItemCount();
-	for (int num = 0; num < nbList; ++num)
-	{
-		KTimerJobItem *item = static_cast<KTimerJobItem*>(m_list->topLevelItem(num));
-        item->job()->save( cfg, QStringLiteral( "Job%1" ).arg( num ) );
-
-	}
-
-	KConfigGroup jobscfg = cfg->group("Jobs");
-    jobscfg.writeEntry( "Number", m_list->topLevelItemCount());
-
-    jobscfg.sync();
-}
-
-// BUG: misnomer... loadConfiguration() ?
-void KTimerPref::loadJobs( KConfig *cfg )
-{
-	const KConfigGroup main=cfg->group("Jobs");
-	
-	showSeconds=main.readEntry("ShowSeconds", false);
-	
-    const int num = main.readEntry( "Number", 0 );
-    for( int n=0; n<num; n++ ) {
-            KTimerJob *job = new KTimerJob;
-            KTimerJobItem *item = new KTimerJobItem( job, m_list );
-
-            connect(job, &KTimerJob::delayChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::valueChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::stateChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::commandChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::onScheduleChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::onPauseChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::onResumeChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::onStopChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::onSuccessChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::onFailureChanged, this, &KTimerPref::jobChanged);
-            connect(job, &KTimerJob::finished, this, &KTimerPref::jobFinished);
-
-            job->load( cfg, QStringLiteral( "Job%1" ).arg(n) );
-
-            job->setUser( item );
-            jobChanged ( job);
-    }
-
-    m_list->update();
-}
-
-
 /*********************************************************************/
 
 
 struct KTimerJobPrivate {
+    unsigned id;
     unsigned delay;
     QString command;
     QString onSchedule;
@@ -483,35 +824,157 @@ struct KTimerJobPrivate {
     bool loop;
     bool oneInstance;
     bool consecutive;
-    unsigned value;
+    bool batch;
+    bool coprocess;
+    bool pipeOutput;
+    unsigned captureSize;   // KiB kept of stdout and of stderr, 0 disables
+    KTimerRingBuffer capturedOutput;
+    KTimerRingBuffer capturedErrors;
+    KTimerUsageStats commandUsage;
+    KTimerUsageStats hookUsage;
+    int input;          // stdin of the next fire
+    int output;         // in-memory file holding the stdout of the last fire
+    int delegated;      // fires handed to a batch or a coprocess, not yet finished
+    KTimerCoprocess *worker;
+    unsigned slack;
+    unsigned maxRuntime;
+    KTimerJob::Priority priority;
+    KTimerJob::CatchUp catchUp;
+    unsigned maxCatchUp;
+    KTimerGroup *group;
+    quint64 generation;     // of the group, when we last looked
+    unsigned value;     // NB: while started, the scheduler's deadline is authoritative
     KTimerJob::States state;
-    QList<QProcess *> processes;
+    QList<KTimerProcess *> processes;
     void *user;
+    KTimerJobStore *store;  // reported to, if any
+    int exitCode;
+    unsigned runtime;
+};
+
 
-    QTimer *timer;
+static unsigned s_maxPipedOutput = 16*1024;    // KiB, 0 for no limit
+
+// An anonymous in-memory file collecting the stdout of a fire, to be handed
+// to the next job of a chain as its stdin. With a limit it is made that big
+// up front, holes taking no memory, and sealed against growing: writes past
+// the limit fail with EPERM. takeOutput() cuts it back to what was written.
+static int createOutputFile()
+{
+#if defined(Q_OS_LINUX) && defined(MFD_CLOEXEC) && defined(MFD_ALLOW_SEALING)
+    const int fd = memfd_create( "ktimer-output", MFD_CLOEXEC|MFD_ALLOW_SEALING );
+    if( fd<0 || s_maxPipedOutput==0 )
+        return fd;
+
+    if( ::ftruncate( fd, off_t( s_maxPipedOutput )*1024 )!=0 || ::fcntl( fd, F_ADD_SEALS, F_SEAL_GROW )!=0 ) {
+        qCWarning(KTIMER_LOG) << "cannot limit the piped output:" << strerror( errno );
+        ::close( fd );
+        return -1;
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+// How the processes of a job are run, by its priority.
+static void applyPriority( KTimerProcess *proc, KTimerJob::Priority priority )
+{
+    switch( priority ) {
+    case KTimerJob::IdlePriority:
+        proc->setPriority( 19, KTimerProcess::IdleScheduling );
+        break;
+    case KTimerJob::LowPriority:
+        proc->setPriority( 10, KTimerProcess::BatchScheduling );
+        break;
+    case KTimerJob::NormalPriority:
+        break;
+    case KTimerJob::HighPriority:
+        proc->setPriority( -5, KTimerProcess::NormalScheduling );
+        break;
+    }
+}
+
+// Highest job id handed out or loaded so far.
+static unsigned s_lastJobId = 0;
+static QHash<unsigned, KTimerJob *> s_jobsById;
+// Every job by group and d->state, in order of id. Stopping a group only
+// bumps its generation: the started and paused jobs of a bucket older than
+// its group count as stopped, and are moved over when the bucket is next used.
+struct KTimerStateBucket {
+    KTimerStateBucket() : generation( 0 ) {}
+    quint64 generation;
+    QMap<unsigned, KTimerJob *> jobs[3];
 };
+static QHash<KTimerGroup *, KTimerStateBucket> s_jobsByState;
 
+static KTimerStateBucket &stateBucket( KTimerGroup *group )
+{
+    KTimerStateBucket &bucket = s_jobsByState[group];
+    if( bucket.generation!=group->generation() ) {
+        for( int state=KTimerJob::Paused; state<=KTimerJob::Started; ++state ) {
+            for( QMap<unsigned, KTimerJob *>::const_iterator it = bucket.jobs[state].constBegin(); it != bucket.jobs[state].constEnd(); ++it )
+                bucket.jobs[KTimerJob::Stopped].insert( it.key(), it.value() );
+            bucket.jobs[state].clear();
+        }
+        bucket.generation = group->generation();
+    }
+    return bucket;
+}
 
 KTimerJob::KTimerJob( QObject *parent)
     : QObject( parent )
 {
     d = new KTimerJobPrivate;
 
+    d->id = ++s_lastJobId;
+    s_jobsById.insert( d->id, this );
     d->delay = 100;
     d->loop = false;
     d->oneInstance = true;
     d->consecutive = false;
+    d->batch = false;
+    d->coprocess = false;
+    d->pipeOutput = false;
+    d->captureSize = 4;
+    d->input = -1;
+    d->output = -1;
+    d->delegated = 0;
+    d->worker = 0;
+    d->slack = 0;
+    d->maxRuntime = 0;
+    d->priority = NormalPriority;
+    d->catchUp = CatchUpOnce;
+    d->maxCatchUp = 10;
+    d->group = KTimerGroup::global();
+    d->generation = d->group->generation();
     d->value = 100;
     d->state = Stopped;
+    addToIndex();
     d->user = 0;
-
-    d->timer = new QTimer( this );
-    connect(d->timer, &QTimer::timeout, this, &KTimerJob::timeout);
+    d->store = 0;
+    d->exitCode = 0;
+    d->runtime = 0;
 }
 
 
 KTimerJob::~KTimerJob()
 {
+    KTimerScheduler::self()->unschedule( this );
+    if( d->worker ) {
+        d->worker->forget( this );
+        KTimerCoprocess::release( d->worker );
+    }
+    setInput( -1 );
+    if( d->output>=0 )
+        ::close( d->output );
+
+    // Commands still running outlive the job, but not its capture buffers.
+    for( int i=0; i<d->processes.count(); ++i )
+        d->processes.at( i )->detach();
+
+    s_jobsById.remove( d->id );
+    removeFromIndex();
     delete d;
 }
 
@@ -519,6 +982,7 @@ KTimerJob::~KTimerJob()
 void KTimerJob::save( KConfig *cfg, const QString& grp )
 {
 	KConfigGroup groupcfg = cfg->group(grp);
+    groupcfg.writeEntry( "Id", d->id );
     groupcfg.writeEntry( "Delay", d->delay );
     groupcfg.writePathEntry( "Command", d->command );
     groupcfg.writePathEntry( "OnSchedule", d->onSchedule );
@@ -530,12 +994,25 @@ void KTimerJob::save( KConfig *cfg, const QString& grp )
     groupcfg.writeEntry( "Loop", d->loop );
     groupcfg.writeEntry( "OneInstance", d->oneInstance );
     groupcfg.writeEntry( "Consecutive", d->consecutive );
-    groupcfg.writeEntry( "State", (int)d->state );
-    groupcfg.writeEntry( "Value", d->value );
-
-    if (d->state == Started)
+    groupcfg.writeEntry( "Batch", d->batch );
+    groupcfg.writeEntry( "Coprocess", d->coprocess );
+    groupcfg.writeEntry( "PipeOutput", d->pipeOutput );
+    groupcfg.writeEntry( "CaptureSize", d->captureSize );
+    groupcfg.writeEntry( "Slack", d->slack );
+    groupcfg.writeEntry( "MaxRuntime", d->maxRuntime );
+    groupcfg.writeEntry( "Priority", (int)d->priority );
+    groupcfg.writeEntry( "CatchUp", (int)d->catchUp );
+    groupcfg.writeEntry( "MaxCatchUp", d->maxCatchUp );
+    groupcfg.writeEntry( "Group", d->group->name() );
+    groupcfg.writeEntry( "State", (int)state() );
+    groupcfg.writeEntry( "Value", value() );
+    groupcfg.writeEntry( "CommandUsage", d->commandUsage.toString() );
+    groupcfg.writeEntry( "HookUsage", d->hookUsage.toString() );
+
+    // The countdown of a job in a paused group is frozen, like a paused job's.
+    if (state() == Started && d->group->isRunning())
     {
-        groupcfg.writeEntry("Expires", (int)(time(NULL)+d->value));
+        groupcfg.writeEntry("Expires", (qint64)time(NULL)+value());
     }
     else
     {
@@ -547,46 +1024,201 @@ void KTimerJob::save( KConfig *cfg, const QString& grp )
 void KTimerJob::load( KConfig *cfg, const QString& grp )
 {
 	KConfigGroup groupcfg = cfg->group(grp);
-    setDelay( groupcfg.readEntry( "Delay", 100 ) );
-    setCommand( groupcfg.readPathEntry( "Command", QString() ) );
-    setOnSchedule( groupcfg.readPathEntry( "OnSchedule", QString() ) );
-    setOnPause(    groupcfg.readPathEntry( "OnPause"   , QString() ) );
-    setOnResume(   groupcfg.readPathEntry( "OnResume"  , QString() ) );
-    setOnStop(     groupcfg.readPathEntry( "OnStop"    , QString() ) );
-    setOnSuccess(  groupcfg.readPathEntry( "OnSuccess" , QString() ) );
-    setOnFailure(  groupcfg.readPathEntry( "OnFailure" , QString() ) );
 
-    setLoop( groupcfg.readEntry( "Loop", false ) );
-    setOneInstance( groupcfg.readEntry( "OneInstance", d->oneInstance ) );
-    setConsecutive( groupcfg.readEntry( "Consecutive", d->consecutive ) );
+    // Jobs saved before ids existed keep the one they were created with.
+    const unsigned id = groupcfg.readEntry( "Id", 0u );
+    if( id )
+        setId( id );
+
+    loadSettings( groupcfg );
+    loadUsage( groupcfg.readEntry( "CommandUsage", QString() ), groupcfg.readEntry( "HookUsage", QString() ) );
     setState( (States)groupcfg.readEntry( "State", (int)Stopped ) );
+    restoreCountdown( groupcfg.readEntry( "Expires", (qint64)0), groupcfg.readEntry("Value", d->delay) );
+}
 
-    int expireTime=groupcfg.readEntry( "Expires", (int)0);
 
+void KTimerJob::restoreCountdown( qint64 expireTime, unsigned value )
+{
     if (expireTime > 0 && state()==Started)
     {
-        int newValue=expireTime-time(NULL);
+        const qint64 now = time(NULL);
 
-        if (newValue > 0)
+        if (expireTime > now)
         {
             //There is time left on the countdown.... maybe not much!
-            setValue( newValue );
+            setValue( (unsigned)qMin<qint64>( expireTime-now, UINT_MAX ) );
+            return;
         }
+
+        // The countdown ran out while we were not running, maybe several times over.
+        const qint64 late = now-expireTime;
+        const qint64 period = qMax( 1u, d->delay );
+        const qint64 missed = d->loop ? 1+late/period : 1;
+
+        unsigned runs = 0;
+        if( d->catchUp==CatchUpOnce )
+            runs = 1;
+        else if( d->catchUp==CatchUpAll )
+            runs = qMin<qint64>( missed, d->maxCatchUp );
+        // Not a stop(): its hook is no catch-up run, and nothing would throttle it.
+        if( d->catchUp==CatchUpRestart )
+            setValue( d->delay );
+        else if( d->loop )
+            setValue( (unsigned)( period - late%period ) );     // back in step with the missed expiries
         else
-        {
-            //NB: the time has *EXPIRED* since we were last activated.... does the user still want it to run?
-            //BUG: WIP: expired timers hold there old value on reload.
-            setValue( groupcfg.readEntry("Value", d->delay) );
-        }
+            setState( Stopped );
+
+        // In the state the job is left in, see KTimerScheduler::catchUp().
+        if( runs )
+            KTimerScheduler::self()->catchUp( this, runs );
     }
     else
     {
         //The timer position is where we left it.
-        setValue( groupcfg.readEntry("Value", d->delay) );
+        setValue( value );
     }
 }
 
 
+void KTimerJob::load( const KTimerSnapshot &snapshot, int index )
+{
+    const KTimerSnapshot::Entry &entry = snapshot.entry( index );
+    if( entry.id )
+        setId( entry.id );
+
+    loadSettings( snapshot, index );
+    loadUsage( snapshot.string( index, KTimerSnapshot::CommandUsage ), snapshot.string( index, KTimerSnapshot::HookUsage ) );
+    setState( (States)qBound( (int)Stopped, (int)entry.state, (int)Started ) );
+    restoreCountdown( entry.expires, entry.value );
+}
+
+
+void KTimerJob::reload( const KTimerSnapshot &snapshot, int index )
+{
+    loadSettings( snapshot, index );
+    loadUsage( snapshot.string( index, KTimerSnapshot::CommandUsage ), snapshot.string( index, KTimerSnapshot::HookUsage ) );
+
+    // Like reload( KConfig*, ... ).
+    const States state = (States)qBound( (int)Stopped, (int)snapshot.entry( index ).state, (int)Started );
+    if( state!=this->state() )
+        setState( state );
+}
+
+
+// Like loadSettings( const KConfigGroup& ).
+void KTimerJob::loadSettings( const KTimerSnapshot &snapshot, int index )
+{
+    const KTimerSnapshot::Entry &entry = snapshot.entry( index );
+    setDelay( entry.delay );
+    setCommand( snapshot.string( index, KTimerSnapshot::Command ) );
+    setOnSchedule( snapshot.string( index, KTimerSnapshot::OnSchedule ) );
+    setOnPause( snapshot.string( index, KTimerSnapshot::OnPause ) );
+    setOnResume( snapshot.string( index, KTimerSnapshot::OnResume ) );
+    setOnStop( snapshot.string( index, KTimerSnapshot::OnStop ) );
+    setOnSuccess( snapshot.string( index, KTimerSnapshot::OnSuccess ) );
+    setOnFailure( snapshot.string( index, KTimerSnapshot::OnFailure ) );
+
+    setLoop( entry.flags & KTimerSnapshot::Loop );
+    setOneInstance( entry.flags & KTimerSnapshot::OneInstance );
+    setConsecutive( entry.flags & KTimerSnapshot::Consecutive );
+    setBatch( entry.flags & KTimerSnapshot::Batch );
+    setCoprocess( entry.flags & KTimerSnapshot::Coprocess );
+    setPipeOutput( entry.flags & KTimerSnapshot::PipeOutput );
+    setCaptureSize( entry.captureSize );
+    setSlack( entry.slack );
+    setMaxRuntime( entry.maxRuntime );
+    setGroup( snapshot.string( index, KTimerSnapshot::Group ) );
+    setPriority( (Priority)qBound( (int)IdlePriority, (int)entry.priority, (int)HighPriority ) );
+    setCatchUp( (CatchUp)qBound( (int)CatchUpOnce, (int)entry.catchUp, (int)CatchUpRestart ) );
+    setMaxCatchUp( entry.maxCatchUp );
+}
+
+
+void KTimerJob::save( KTimerSnapshotWriter *snapshot )
+{
+    // The padding is written and checksummed too.
+    KTimerSnapshot::Entry entry;
+    memset( &entry, 0, sizeof( entry ) );
+    entry.id = d->id;
+    entry.delay = d->delay;
+    entry.value = value();
+    entry.flags = ( d->loop ? KTimerSnapshot::Loop : 0 )
+                | ( d->oneInstance ? KTimerSnapshot::OneInstance : 0 )
+                | ( d->consecutive ? KTimerSnapshot::Consecutive : 0 )
+                | ( d->batch ? KTimerSnapshot::Batch : 0 )
+                | ( d->coprocess ? KTimerSnapshot::Coprocess : 0 )
+                | ( d->pipeOutput ? KTimerSnapshot::PipeOutput : 0 );
+    entry.captureSize = d->captureSize;
+    entry.slack = d->slack;
+    entry.maxRuntime = d->maxRuntime;
+    entry.priority = d->priority;
+    entry.catchUp = d->catchUp;
+    entry.maxCatchUp = d->maxCatchUp;
+    entry.state = state();
+    // Like save( KConfig* ).
+    entry.expires = state()==Started && d->group->isRunning() ? (qint64)time(NULL)+value() : 0;
+
+    const QString strings[KTimerSnapshot::StringCount] = {
+        d->command, d->onSchedule, d->onPause, d->onResume, d->onStop, d->onSuccess, d->onFailure, d->group->name(),
+        d->commandUsage.toString(), d->hookUsage.toString()
+    };
+    snapshot->add( entry, strings );
+}
+
+
+void KTimerJob::reload( KConfig *cfg, const QString& grp )
+{
+    const KConfigGroup groupcfg = cfg->group( grp );
+    loadSettings( groupcfg );
+    loadUsage( groupcfg.readEntry( "CommandUsage", QString() ), groupcfg.readEntry( "HookUsage", QString() ) );
+
+    // Only an actual change of the state touches the countdown.
+    const States state = (States)groupcfg.readEntry( "State", (int)this->state() );
+    if( state!=this->state() )
+        setState( state );
+}
+
+
+// Followers get the statistics of the leader's runs with each save.
+void KTimerJob::loadUsage( const QString &command, const QString &hooks )
+{
+    if( command==d->commandUsage.toString() && hooks==d->hookUsage.toString() )
+        return;
+
+    d->commandUsage.fromString( command );
+    d->hookUsage.fromString( hooks );
+    notifyChanged( Usage );
+}
+
+
+// Everything but the state and the countdown; the setters ignore what did not change.
+void KTimerJob::loadSettings( const KConfigGroup &groupcfg )
+{
+    setDelay( groupcfg.readEntry( "Delay", 100 ) );
+    setCommand( groupcfg.readPathEntry( "Command", QString() ) );
+    setOnSchedule( groupcfg.readPathEntry( "OnSchedule", QString() ) );
+    setOnPause(    groupcfg.readPathEntry( "OnPause"   , QString() ) );
+    setOnResume(   groupcfg.readPathEntry( "OnResume"  , QString() ) );
+    setOnStop(     groupcfg.readPathEntry( "OnStop"    , QString() ) );
+    setOnSuccess(  groupcfg.readPathEntry( "OnSuccess" , QString() ) );
+    setOnFailure(  groupcfg.readPathEntry( "OnFailure" , QString() ) );
+
+    setLoop( groupcfg.readEntry( "Loop", false ) );
+    setOneInstance( groupcfg.readEntry( "OneInstance", d->oneInstance ) );
+    setConsecutive( groupcfg.readEntry( "Consecutive", d->consecutive ) );
+    setBatch( groupcfg.readEntry( "Batch", false ) );
+    setCoprocess( groupcfg.readEntry( "Coprocess", false ) );
+    setPipeOutput( groupcfg.readEntry( "PipeOutput", false ) );
+    setCaptureSize( groupcfg.readEntry( "CaptureSize", 4u ) );
+    setSlack( groupcfg.readEntry( "Slack", 0 ) );
+    setMaxRuntime( groupcfg.readEntry( "MaxRuntime", 0u ) );
+    setGroup( groupcfg.readEntry( "Group", QString() ) );
+    setPriority( (Priority)qBound( (int)IdlePriority, groupcfg.readEntry( "Priority", (int)NormalPriority ), (int)HighPriority ) );
+    setCatchUp( (CatchUp)qBound( (int)CatchUpOnce, groupcfg.readEntry( "CatchUp", (int)CatchUpOnce ), (int)CatchUpRestart ) );
+    setMaxCatchUp( groupcfg.readEntry( "MaxCatchUp", 10u ) );
+}
+
+
 // Format given seconds to hour:minute:seconds and return QString
 QString KTimerJob::formatTime( int seconds ) const
 {
@@ -637,6 +1269,182 @@ void KTimerJob::secondsToHMS( int secs, int *hours, int *minutes, int *seconds )
     (*seconds) = s % 60;
 }
 
+unsigned KTimerJob::id() const
+{
+    return d->id;
+}
+
+KTimerJob *KTimerJob::find( unsigned id )
+{
+    return s_jobsById.value( id );
+}
+
+
+QList<KTimerJob *> KTimerJob::jobs( States state )
+{
+    QList<KTimerJob *> jobs;
+    const QStringList names = KTimerGroup::names();
+    for( int i=-1; i<names.count(); ++i ) {
+        KTimerGroup *group = i<0 ? KTimerGroup::global() : KTimerGroup::find( names.at( i ) );
+        QHash<KTimerGroup *, KTimerStateBucket>::const_iterator bucket = s_jobsByState.constFind( group );
+        if( bucket==s_jobsByState.constEnd() )
+            continue;
+
+        // What a stop left started or paused is not; moving it over to the
+        // stopped ones costs no more than returning it.
+        if( bucket->generation!=group->generation() ) {
+            if( state==Stopped )
+                jobs += stateBucket( group ).jobs[Stopped].values();
+            continue;
+        }
+        jobs += bucket->jobs[state].values();
+    }
+    return jobs;
+}
+
+
+// A job that was handed out the id before the saved ones were all loaded, or
+// that has it too in a hand-edited file, moves on to a fresh one.
+void KTimerJob::setId( unsigned id )
+{
+    if( id==d->id )
+        return;
+
+    s_lastJobId = qMax( s_lastJobId, id );
+    KTimerJob *other = s_jobsById.value( id );
+    if( other )
+        other->setId( ++s_lastJobId );
+
+    removeFromIndex();
+    s_jobsById.remove( d->id );
+    d->id = id;
+    s_jobsById.insert( d->id, this );
+    addToIndex();
+}
+
+
+void KTimerJob::addToIndex()
+{
+    stateBucket( d->group ).jobs[d->state].insert( d->id, this );
+}
+
+
+// A stop of the group may have moved the job to the stopped ones already.
+void KTimerJob::removeFromIndex()
+{
+    KTimerStateBucket &bucket = stateBucket( d->group );
+    for( int state=Stopped; state<=Started; ++state ) {
+        if( bucket.jobs[state].value( d->id )==this )
+            bucket.jobs[state].remove( d->id );
+    }
+}
+
+int KTimerJob::takeOutput()
+{
+    const int fd = d->output;
+    d->output = -1;
+
+    // The child shared our file offset, which is where it stopped writing.
+    if( fd>=0 ) {
+        const off_t written = ::lseek( fd, 0, SEEK_CUR );
+        if( written<0 || ::ftruncate( fd, written )<0 )
+            qCWarning(KTIMER_LOG) << "cannot cut the piped output back to what was written:" << strerror( errno );
+        ::lseek( fd, 0, SEEK_SET );
+    }
+    return fd;
+}
+
+unsigned KTimerJob::maxPipedOutput()
+{
+    return s_maxPipedOutput;
+}
+
+void KTimerJob::setMaxPipedOutput( unsigned kib )
+{
+    s_maxPipedOutput = kib;
+}
+
+void KTimerJob::setInput( int fd )
+{
+    if( d->input>=0 )
+        ::close( d->input );
+    d->input = fd;
+}
+
+// Prefixed with a note when the beginning did not fit.
+static QByteArray capturedText( const KTimerRingBuffer &ring )
+{
+    if( ring.dropped()==0 )
+        return ring.toByteArray();
+
+    return "[... " + QByteArray::number( ring.dropped() ) + " bytes skipped ...]\n" + ring.toByteArray();
+}
+
+QByteArray KTimerJob::capturedOutput() const
+{
+    return capturedText( d->capturedOutput );
+}
+
+QByteArray KTimerJob::capturedErrors() const
+{
+    return capturedText( d->capturedErrors );
+}
+
+int KTimerJob::exitCode() const
+{
+    return d->exitCode;
+}
+
+unsigned KTimerJob::runtime() const
+{
+    return d->runtime;
+}
+
+const KTimerUsageStats &KTimerJob::commandUsage() const
+{
+    return d->commandUsage;
+}
+
+const KTimerUsageStats &KTimerJob::hookUsage() const
+{
+    return d->hookUsage;
+}
+
+static QString usageLine( const QString &label, const KTimerUsageStats &usage, KTimerUsageStats::Metric metric )
+{
+    if( metric==KTimerUsageStats::MaxRss ) {
+        KFormat format;
+        return i18nc( "label: median / 95th percentile / maximum", "%1: %2 / %3 / %4", label,
+                      format.formatByteSize( usage.percentile( metric, 50 )*1024.0 ),
+                      format.formatByteSize( usage.percentile( metric, 95 )*1024.0 ),
+                      format.formatByteSize( usage.maximum( metric )*1024.0 ) );
+    }
+
+    return i18nc( "label: median / 95th percentile / maximum", "%1: %2 / %3 / %4", label,
+                  formatMs( usage.percentile( metric, 50 ) ),
+                  formatMs( usage.percentile( metric, 95 ) ),
+                  formatMs( usage.maximum( metric ) ) );
+}
+
+QString KTimerJob::usageSummary() const
+{
+    QStringList lines;
+    if( d->commandUsage.count() ) {
+        lines << i18np( "Command, %1 run (median / 95th percentile / maximum):",
+                        "Command, %1 runs (median / 95th percentile / maximum):", (int)d->commandUsage.count() );
+        lines << usageLine( i18n( "User time" ), d->commandUsage, KTimerUsageStats::UserTime );
+        lines << usageLine( i18n( "System time" ), d->commandUsage, KTimerUsageStats::SystemTime );
+        lines << usageLine( i18n( "Wall time" ), d->commandUsage, KTimerUsageStats::WallTime );
+        lines << usageLine( i18n( "Memory" ), d->commandUsage, KTimerUsageStats::MaxRss );
+    }
+    if( d->hookUsage.count() ) {
+        lines << i18np( "Hooks, %1 run:", "Hooks, %1 runs:", (int)d->hookUsage.count() );
+        lines << usageLine( i18n( "CPU time" ), d->hookUsage, KTimerUsageStats::CpuTime );
+        lines << usageLine( i18n( "Memory" ), d->hookUsage, KTimerUsageStats::MaxRss );
+    }
+    return lines.join( QLatin1Char( '\n' ) );
+}
+
 void *KTimerJob::user()
 {
     return d->user;
@@ -669,7 +1477,7 @@ void KTimerJob::stop()
 
 void KTimerJob::start()
 {
-    if (d->state==Paused) {
+    if (state()==Paused) {
         fireInferior(d->onResume);
     } else {
         fireInferior(d->onSchedule);
@@ -693,11 +1501,10 @@ void KTimerJob::setDelay( unsigned sec )
     if( d->delay!=sec ) {
         d->delay = sec;
 
-        if( d->state==Stopped )
+        if( state()==Stopped )
             setValue( sec );
 
-        emit delayChanged( this, sec );
-        emit changed( this );
+        notifyChanged( Delay );
     }
 }
 
@@ -743,8 +1550,14 @@ void KTimerJob::setCommand( const QString &cmd )
 {
     if( d->command!=cmd ) {
         d->command = cmd;
-        emit commandChanged( this, cmd );
-        emit changed( this );
+
+        // The worker runs the old command.
+        if( d->worker ) {
+            KTimerCoprocess::release( d->worker );
+            d->worker = 0;
+        }
+
+        notifyChanged( Command );
     }
 }
 
@@ -752,8 +1565,7 @@ void KTimerJob::setOnSchedule( const QString &cmd )
 {
     if( d->onSchedule!=cmd ) {
         d->onSchedule = cmd;
-        emit onScheduleChanged( this, cmd );
-        emit changed( this );
+        notifyChanged( Hooks );
     }
 }
 
@@ -761,8 +1573,7 @@ void KTimerJob::setOnPause( const QString &cmd )
 {
     if( d->onPause!=cmd ) {
         d->onPause = cmd;
-        emit onPauseChanged( this, cmd );
-        emit changed( this );
+        notifyChanged( Hooks );
     }
 }
 
@@ -770,8 +1581,7 @@ void KTimerJob::setOnResume( const QString &cmd )
 {
     if( d->onResume!=cmd ) {
         d->onResume = cmd;
-        emit onResumeChanged( this, cmd );
-        emit changed( this );
+        notifyChanged( Hooks );
     }
 }
 
@@ -779,8 +1589,7 @@ void KTimerJob::setOnStop( const QString &cmd )
 {
     if( d->onStop!=cmd ) {
         d->onStop = cmd;
-        emit onStopChanged( this, cmd );
-        emit changed( this );
+        notifyChanged( Hooks );
     }
 }
 
@@ -788,8 +1597,7 @@ void KTimerJob::setOnSuccess( const QString &cmd )
 {
     if( d->onSuccess!=cmd ) {
         d->onSuccess = cmd;
-        emit onSuccessChanged( this, cmd );
-        emit changed( this );
+        notifyChanged( Hooks );
     }
 }
 
@@ -797,8 +1605,7 @@ void KTimerJob::setOnFailure( const QString &cmd )
 {
     if( d->onFailure!=cmd ) {
         d->onFailure = cmd;
-        emit onFailureChanged( this, cmd );
-        emit changed( this );
+        notifyChanged( Hooks );
     }
 }
 
@@ -814,8 +1621,7 @@ void KTimerJob::setLoop( bool loop )
 {
     if( d->loop!=loop ) {
         d->loop = loop;
-        emit loopChanged( this, loop );
-        emit changed( this );
+        notifyChanged( Options );
     }
 }
 
@@ -830,8 +1636,7 @@ void KTimerJob::setOneInstance( bool one )
 {
     if( d->oneInstance!=one ) {
         d->oneInstance = one;
-        emit oneInstanceChanged( this, one );
-        emit changed( this );
+        notifyChanged( Options );
     }
 }
 
@@ -846,75 +1651,319 @@ void KTimerJob::setConsecutive( bool consecutive )
 {
     if( d->consecutive!=consecutive ) {
         d->consecutive = consecutive;
-        emit consecutiveChanged( this, consecutive );
-        emit changed( this );
+        notifyChanged( Options );
+    }
+}
+
+
+bool KTimerJob::batch() const
+{
+    return d->batch;
+}
+
+
+void KTimerJob::setBatch( bool batch )
+{
+    if( d->batch!=batch ) {
+        d->batch = batch;
+        notifyChanged( Options );
+    }
+}
+
+
+bool KTimerJob::coprocess() const
+{
+    return d->coprocess;
+}
+
+
+void KTimerJob::setCoprocess( bool coprocess )
+{
+    if( d->coprocess!=coprocess ) {
+        d->coprocess = coprocess;
+
+        if( !coprocess && d->worker ) {
+            KTimerCoprocess::release( d->worker );
+            d->worker = 0;
+        }
+
+        notifyChanged( Options );
+    }
+}
+
+
+// A oneInstance job whose last run has not finished yet, so that fire() would skip.
+bool KTimerJob::isBusy() const
+{
+    return d->oneInstance && ( !d->processes.isEmpty() || d->delegated>0 );
+}
+
+
+bool KTimerJob::pipeOutput() const
+{
+    return d->pipeOutput;
+}
+
+
+void KTimerJob::setPipeOutput( bool pipe )
+{
+    if( d->pipeOutput!=pipe ) {
+        d->pipeOutput = pipe;
+        notifyChanged( Options );
+    }
+}
+
+
+unsigned KTimerJob::captureSize() const
+{
+    return d->captureSize;
+}
+
+
+void KTimerJob::setCaptureSize( unsigned kib )
+{
+    if( d->captureSize!=kib ) {
+        d->captureSize = kib;
+        d->capturedOutput.setCapacity( kib*1024 );
+        d->capturedErrors.setCapacity( kib*1024 );
+        notifyChanged( Options );
+    }
+}
+
+
+unsigned KTimerJob::slack() const
+{
+    return d->slack;
+}
+
+
+void KTimerJob::setSlack( unsigned sec )
+{
+    if( d->slack!=sec ) {
+        d->slack = sec;
+
+        // The scheduler sizes its wakeup windows from the slack, hand the job in again.
+        KTimerScheduler *scheduler = KTimerScheduler::self();
+        if( scheduler->isScheduled( this ) )
+            scheduler->schedule( this, scheduler->deadline( this ) );
+
+        notifyChanged( Limits );
+    }
+}
+
+
+unsigned KTimerJob::maxRuntime() const
+{
+    return d->maxRuntime;
+}
+
+
+void KTimerJob::setMaxRuntime( unsigned sec )
+{
+    if( d->maxRuntime!=sec ) {
+        d->maxRuntime = sec;
+        notifyChanged( Limits );
+    }
+}
+
+
+KTimerJob::Priority KTimerJob::priority() const
+{
+    return d->priority;
+}
+
+
+void KTimerJob::setPriority( KTimerJob::Priority priority )
+{
+    if( d->priority!=priority ) {
+        d->priority = priority;
+        notifyChanged( Limits );
+    }
+}
+
+
+KTimerJob::CatchUp KTimerJob::catchUp() const
+{
+    return d->catchUp;
+}
+
+
+void KTimerJob::setCatchUp( KTimerJob::CatchUp catchUp )
+{
+    if( d->catchUp!=catchUp ) {
+        d->catchUp = catchUp;
+        notifyChanged( Limits );
+    }
+}
+
+
+unsigned KTimerJob::maxCatchUp() const
+{
+    return d->maxCatchUp;
+}
+
+
+void KTimerJob::setMaxCatchUp( unsigned runs )
+{
+    if( d->maxCatchUp!=runs ) {
+        d->maxCatchUp = runs;
+        notifyChanged( Limits );
+    }
+}
+
+
+KTimerGroup *KTimerJob::group() const
+{
+    return d->group;
+}
+
+
+void KTimerJob::setGroup( const QString &name )
+{
+    KTimerGroup *group = KTimerGroup::group( name );
+    if( d->group==group )
+        return;
+
+    // Carry the countdown over from the clock of the old group to the new one.
+    syncGroup();
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+    const bool started = d->state==Started;
+    if( started ) {
+        d->value = value();
+        scheduler->unschedule( this );
+    }
+
+    removeFromIndex();
+    d->group = group;
+    d->generation = group->generation();
+    addToIndex();
+    if( started && d->value!=0 )
+        scheduler->schedule( this, group->time() + d->value*1000LL );
+
+    notifyChanged( Group );
+}
+
+
+// A stop of the group only drops its jobs from the scheduler; the jobs
+// themselves catch up here, the next time anybody looks at them.
+void KTimerJob::syncGroup() const
+{
+    const quint64 generation = d->group->generation();
+    if( d->generation!=generation ) {
+        d->generation = generation;
+        if( d->state!=Stopped ) {
+            KTimerJob *self = const_cast<KTimerJob *>( this );
+            self->removeFromIndex();
+            d->state = Stopped;
+            d->value = d->delay;
+            self->addToIndex();
+        }
     }
 }
 
 
 unsigned KTimerJob::value() const
 {
+    syncGroup();
+    if( d->state==Started ) {
+        const KTimerScheduler *scheduler = KTimerScheduler::self();
+        const qint64 deadline = scheduler->deadline( this );
+        if( deadline>=0 ) {
+            const qint64 left = deadline - d->group->time();
+            return left>0 ? (unsigned)( ( left+999 ) / 1000 ) : 0;
+        }
+    }
+
     return d->value;
 }
 
 
 void KTimerJob::setValue( unsigned value )
 {
-    if( d->value!=value ) {
+    if( this->value()!=value ) {
         d->value = value;
-        emit valueChanged( this, value );
-        emit changed( this );
+
+        if( d->state==Started ) {
+            KTimerScheduler *scheduler = KTimerScheduler::self();
+            if( value!=0 )
+                scheduler->schedule( this, d->group->time() + value*1000LL );
+            else
+                scheduler->unschedule( this );
+        }
+
+        notifyChanged( Value );
     }
 }
 
 
 KTimerJob::States KTimerJob::state() const
 {
+    syncGroup();
     return d->state;
 }
 
 
 void KTimerJob::setState( KTimerJob::States state )
 {
+    syncGroup();
     if( d->state!=state ) {
-        if( state==Started )
-            d->timer->start( 1000 );
-        else
-            d->timer->stop();
+        KTimerScheduler *scheduler = KTimerScheduler::self();
+
+        // Freeze the countdown where it is, restart it from there.
+        if( d->state==Started ) {
+            d->value = value();
+            scheduler->unschedule( this );
+        }
+
+        removeFromIndex();
+        d->state = state;
+        addToIndex();
+        if( state==Started && d->value!=0 )
+            scheduler->schedule( this, d->group->time() + d->value*1000LL );
 
         if( state==Stopped )
             setValue( d->delay );
 
-        d->state = state;
-        emit stateChanged( this, state );
-        emit changed( this );
+        notifyChanged( State );
     }
 }
 
 
+// Called by the scheduler once the countdown (give or take the slack) ran out.
 void KTimerJob::timeout()
 {
-    if( d->state==Started && d->value!=0 ) {
-        setValue( d->value-1 );
-        if( d->value==0 ) {
-            fire();
-            if( d->loop )
-                setValue( d->delay );
-            else
-                stop();
-        }
+    if( d->state==Started ) {
+        setValue( 0 );
+        fire();
+        if( d->loop )
+            setValue( d->delay );
+        else
+            stop();
     }
 }
 
 
-void KTimerJob::processExited(int, QProcess::ExitStatus status)
+void KTimerJob::processExited(int exitCode, QProcess::ExitStatus status)
 {
-	QProcess * proc = static_cast<QProcess*>(sender());
-    const bool ok = status==0;
+	KTimerProcess * proc = static_cast<KTimerProcess*>(sender());
+    d->exitCode = status==QProcess::NormalExit ? exitCode : -1;
+    d->runtime = proc->usage().wallMs;
+    const bool ok = proc->succeeded( status );
+    if( proc->timedOut() )
+        KTimerScheduler::self()->countWatchdogKill();
     const int i = d->processes.indexOf( proc);
     if (i != -1)
-        delete d->processes.takeAt(i);
+        d->processes.takeAt(i)->deleteLater();
+
+    d->commandUsage.add( proc->usage() );
+    notifyChanged( Usage );
+
+    finish( ok );
+}
+
 
+void KTimerJob::finish( bool ok )
+{
     if( ok ) {
         fireInferior(d->onSuccess);
     } else {
@@ -922,35 +1971,148 @@ void KTimerJob::processExited(int, QProcess::ExitStatus status)
         fireInferior(d->onFailure);
     }
 
-    emit finished( this, !ok );
+    notifyFinished( !ok );
+}
+
+
+void KTimerJob::setStore( KTimerJobStore *store )
+{
+    d->store = store;
+}
+
+
+void KTimerJob::notifyChanged( Fields fields )
+{
+    emit changed( this, fields );
+    if( d->store )
+        d->store->noteChanged( this, fields );
+}
+
+
+void KTimerJob::notifyFired()
+{
+    emit fired( this );
+    if( d->store )
+        d->store->noteFired( this );
+}
+
+
+void KTimerJob::notifyFinished( bool error )
+{
+    emit finished( this, error );
+    if( d->store )
+        d->store->noteFinished( this, error );
+}
+
+
+void KTimerJob::delegateFired()
+{
+    notifyFired();
+}
+
+
+void KTimerJob::delegateFinished( bool ok )
+{
+    d->delegated--;
+    d->exitCode = ok ? 0 : 1;
+    d->runtime = 0;
+    finish( ok );
 }
 
 
 void KTimerJob::fire()
 {
-    if( !d->oneInstance || d->processes.isEmpty() ) {
-        QProcess *proc = new QProcess;
+    // Another ktimer runs the jobs, this one only shows them.
+    if( KTimerScheduler::self()->isFollowing() ) {
+        KTimerScheduler::self()->holdBack( this );
+        return;
+    }
+
+    // Coprocess jobs trigger their long-lived worker instead of starting the command.
+    if( d->coprocess && !d->command.simplified().isEmpty() ) {
+        if( !d->oneInstance || (d->processes.isEmpty() && d->delegated==0) ) {
+            if( !d->worker )
+                d->worker = KTimerCoprocess::acquire( d->command.simplified() );
+            d->delegated++;
+            d->worker->trigger( this );
+        }
+        return;
+    }
+
+    // Batch jobs leave the invocation to the batch collecting their command.
+    if( d->batch && !d->command.simplified().isEmpty() ) {
+        if( !d->oneInstance || (d->processes.isEmpty() && d->delegated==0) ) {
+            if( KTimerBatch::enqueue( this ) )
+                d->delegated++;
+        }
+        return;
+    }
+
+    if( !d->oneInstance || (d->processes.isEmpty() && d->delegated==0) ) {
+        KTimerProcess *proc = new KTimerProcess;
         d->processes.append( proc );
-        connect(proc, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this, &KTimerJob::processExited);
-        if (!d->command.simplified ().isEmpty()) {
-	        proc->start(d->command);
-	        emit fired( this );
+        connect(proc, &KTimerProcess::finished, this, &KTimerJob::processExited);
+
+        if( d->input>=0 )
+            proc->setStandardInputFd( d->input );
+        proc->setMaxRuntime( d->maxRuntime*1000 );
+        applyPriority( proc, d->priority );
+
+        if( d->captureSize ) {
+            d->capturedOutput.setCapacity( d->captureSize*1024 );
+            d->capturedErrors.setCapacity( d->captureSize*1024 );
+            d->capturedOutput.clear();
+            d->capturedErrors.clear();
+            proc->setStandardOutputCapture( &d->capturedOutput );
+            proc->setStandardErrorCapture( &d->capturedErrors );
         }
-        if(proc->state() == QProcess::NotRunning) {
+
+        // The child writes straight into the in-memory file, nothing passes through us.
+        if( d->pipeOutput ) {
+            if( d->output>=0 )
+                ::close( d->output );
+            d->output = createOutputFile();
+            if( d->output>=0 )
+                proc->setStandardOutputFd( d->output );
+        }
+
+        const bool started = !d->command.simplified ().isEmpty() && proc->start(d->command);
+
+        // The input is used up, the child has its own copy.
+        setInput( -1 );
+
+        if( started ) {
+	        notifyFired();
+        } else {
             const int i = d->processes.indexOf( proc);
             if (i != -1)
                 delete d->processes.takeAt(i);
+            d->exitCode = -1;
+            d->runtime = 0;
             emit error( this );
-            emit finished( this, true );
+            notifyFinished( true );
         }
     }
 }
 
 void KTimerJob::fireInferior(const QString &command)
 {
+    if( KTimerScheduler::self()->isFollowing() )
+        return;
+
     if (!command.simplified().isEmpty()) {
-        QProcess *proc = new QProcess;
-	    proc->start(command);
+        KTimerProcess *proc = new KTimerProcess;
+        connect(proc, &KTimerProcess::finished, this, [this, proc]() {
+            if( proc->timedOut() )
+                KTimerScheduler::self()->countWatchdogKill();
+            d->hookUsage.add( proc->usage() );
+            notifyChanged( Usage );
+        });
+        connect(proc, &KTimerProcess::finished, proc, &QObject::deleteLater);
+        proc->setMaxRuntime( d->maxRuntime*1000 );
+        applyPriority( proc, d->priority );
+        if( !proc->start(command) )
+            delete proc;
     }
 }
 
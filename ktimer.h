@@ -20,12 +20,19 @@
 #define KTIMER_H_INCLUDED
 
 #include <QDialog>
+#include <QHash>
 #include <QWidget>
 #include <QProcess>
 #include "ui_prefwidget.h"
 
 class QTreeWidgetItem;
 class KConfig;
+class KConfigGroup;
+class KTimerGroup;
+class KTimerJobStore;
+class KTimerSnapshot;
+class KTimerSnapshotWriter;
+class KTimerUsageStats;
 
 class KTimerJob : public QObject {
  Q_OBJECT
@@ -35,7 +42,31 @@ class KTimerJob : public QObject {
     virtual ~KTimerJob();
 
     enum States { Stopped, Paused, Started };
+    // Jobs expiring in the same wakeup of the scheduler are started in order of
+    // decreasing priority, across groups; see KTimerScheduler::wakeup().
+    enum Priority { IdlePriority, LowPriority, NormalPriority, HighPriority };
+    // What a started job does about expiries missed while ktimer was not running.
+    enum CatchUp { CatchUpOnce, CatchUpAll, CatchUpSkip, CatchUpRestart };
+    // What changed about a job, see changed().
+    enum Field {
+        Delay = 0x0001,
+        Value = 0x0002,
+        State = 0x0004,
+        Command = 0x0008,
+        Hooks = 0x0010,         // onSchedule() to onFailure()
+        Options = 0x0020,       // loop() to pipeOutput(), captureSize()
+        Limits = 0x0040,        // slack(), maxRuntime(), priority(), catchUp(), maxCatchUp()
+        Group = 0x0080,
+        Usage = 0x0100          // commandUsage(), hookUsage(); saved, but not worth a save of its own
+    };
+    Q_DECLARE_FLAGS(Fields, Field)
 
+    unsigned id() const;
+    static KTimerJob *find( unsigned id );
+    // All jobs in the given state: those of the global group, then those of
+    // the named groups by name, each in order of id. In O(groups + jobs found).
+    // See KTimerScheduler::upcoming() for the started ones by expiry.
+    static QList<KTimerJob *> jobs( States state );
     unsigned delay() const;
     QString command() const;
     QString onSchedule() const;
@@ -48,13 +79,54 @@ class KTimerJob : public QObject {
     bool loop() const;
     bool oneInstance() const;
     bool consecutive() const;
+    bool batch() const;
+    bool coprocess() const;
+    bool pipeOutput() const;
+    unsigned captureSize() const;
+    unsigned slack() const;
+    // Seconds a run of the command or of a hook may take before it is killed, 0 for no limit.
+    unsigned maxRuntime() const;
+    Priority priority() const;
+    CatchUp catchUp() const;
+    // Most missed runs made up for with CatchUpAll.
+    unsigned maxCatchUp() const;
+    // Never null; jobs without a named group are in the global group.
+    KTimerGroup *group() const;
     unsigned value() const;
     States state() const;
     void *user();
     void setUser( void *user );
 
+    // Output of the last fire when pipeOutput() is set, rewound; the caller owns the fd.
+    int takeOutput();
+    // KiB of output a fire may hand on with pipeOutput(), 0 for no limit; the
+    // command's writes beyond it fail. PipeOutputLimit in [Jobs], 16 MiB by default.
+    static unsigned maxPipedOutput();
+    static void setMaxPipedOutput( unsigned kib );
+    // Stdin for the next fire, e.g. the output of the previous job of a chain. Takes ownership.
+    void setInput( int fd );
+
+    // The tail of what the command wrote during the last fire, see captureSize().
+    QByteArray capturedOutput() const;
+    QByteArray capturedErrors() const;
+
+    // Of the last run that finished: its exit code, -1 if it crashed or did
+    // not start, and how long it took in msecs, 0 if not known.
+    int exitCode() const;
+    unsigned runtime() const;
+
+    // Resources used by the last runs of the command and of the hooks.
+    const KTimerUsageStats &commandUsage() const;
+    const KTimerUsageStats &hookUsage() const;
+    QString usageSummary() const;
+
     void load( KConfig *cfg, const QString& grp );
+    // Applies changed settings to the running job, keeping its countdown.
+    void reload( KConfig *cfg, const QString& grp );
     void save( KConfig *cfg, const QString& grp );
+    void load( const KTimerSnapshot &snapshot, int index );
+    void reload( const KTimerSnapshot &snapshot, int index );
+    void save( KTimerSnapshotWriter *snapshot );
     QString formatTime( int seconds ) const;
     int timeToSeconds( int hours, int minutes, int seconds ) const;
     void secondsToHMS( int secs, int *hours, int *minutes, int *seconds ) const;
@@ -74,6 +146,16 @@ class KTimerJob : public QObject {
     void setLoop( bool loop );
     void setOneInstance( bool one );
     void setConsecutive( bool consecutive );
+    void setBatch( bool batch );
+    void setCoprocess( bool coprocess );
+    void setPipeOutput( bool pipe );
+    void setCaptureSize( unsigned kib );
+    void setSlack( unsigned sec );
+    void setMaxRuntime( unsigned sec );
+    void setPriority( Priority priority );
+    void setCatchUp( CatchUp catchUp );
+    void setMaxCatchUp( unsigned runs );
+    void setGroup( const QString &name );
     void setValue( unsigned int value );
     void setValue( int value );
     void setState( States state );
@@ -84,22 +166,9 @@ class KTimerJob : public QObject {
     void toggle();
 
  signals:
-    void stateChanged( KTimerJob *job, States state );
-    void delayChanged( KTimerJob *job, unsigned int sec );
-    void commandChanged( KTimerJob *job, const QString &cmd );
-    void onScheduleChanged( KTimerJob *job, const QString &cmd );
-    void onPauseChanged( KTimerJob *job, const QString &cmd );
-    void onResumeChanged( KTimerJob *job, const QString &cmd );
-    void onStopChanged( KTimerJob *job, const QString &cmd );
-    void onSuccessChanged( KTimerJob *job, const QString &cmd );
-    void onFailureChanged( KTimerJob *job, const QString &cmd );
-
-    void loopChanged( KTimerJob *job, bool loop );
-    void oneInstanceChanged( KTimerJob *job, bool one );
-    void consecutiveChanged( KTimerJob *job, bool consecutive );
-    void valueChanged( KTimerJob *job, unsigned int value );
-
-    void changed( KTimerJob *job );
+    // Jobs kept in a KTimerJobStore also report to it directly, and the
+    // store reports for all of them at once; these are for jobs on their own.
+    void changed( KTimerJob *job, KTimerJob::Fields fields );
     void fired( KTimerJob *job );
     void finished( KTimerJob *job, bool error );
     void error( KTimerJob *job );
@@ -113,15 +182,41 @@ class KTimerJob : public QObject {
     void processExited(int, QProcess::ExitStatus);
 
  private:
+    void loadSettings( const KConfigGroup &groupcfg );
+    void loadSettings( const KTimerSnapshot &snapshot, int index );
+    void loadUsage( const QString &command, const QString &hooks );
+    void restoreCountdown( qint64 expireTime, unsigned value );
+    void syncGroup() const;
+    bool isBusy() const;
+    void setId( unsigned id );
+    void addToIndex();
+    void removeFromIndex();
+    void setStore( KTimerJobStore *store );
+    void notifyChanged( Fields fields );
+    void notifyFired();
+    void notifyFinished( bool error );
+    void finish( bool ok );
+    void delegateFired();
+    void delegateFinished( bool ok );
+
+    friend class KTimerScheduler;
+    friend class KTimerBatch;
+    friend class KTimerCoprocess;
+    friend class KTimerJobStore;
     struct KTimerJobPrivate *d;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(KTimerJob::Fields)
 
+
+/**
+ * The window listing the jobs of a KTimerJobStore, and editing them.
+ */
 class KTimerPref : public QDialog, public Ui::PrefWidget
 {
     Q_OBJECT
  public:
-    KTimerPref( QWidget *parent=0);
+    explicit KTimerPref( KTimerJobStore *store, QWidget *parent=0 );
     virtual ~KTimerPref();
 
  public slots:
@@ -133,17 +228,29 @@ class KTimerPref : public QDialog, public Ui::PrefWidget
     void edit();
     void remove();
     void help();
+    void showOutput();
+    void showUpcoming();
     void currentChanged( QTreeWidgetItem * , QTreeWidgetItem *);
     void currentDoubleClicked( QTreeWidgetItem *, int column);
 
-    void saveJobs( KConfig *cfg );
-    void loadJobs( KConfig *cfg );
-    void saveAllJobs();
-
  private slots:
+    void jobAdded( KTimerJob *job );
+    void jobRemoved( KTimerJob *job );
+    void jobReloaded( KTimerJob *job );
+    void jobsChanged( const QHash<KTimerJob *, KTimerJob::Fields> &changes );
     void jobChanged( KTimerJob *job );
     void jobFinished( KTimerJob *job, bool error );
+    void jobGroupChanged( KTimerJob *job );
+    void groupChanged( KTimerGroup *group );
+    void jobMatchChanged( KTimerJob *job );
+    void filterChanged();
+    void leaderElected();
     void delayChanged();
+    void refresh();
+
+ protected:
+    void showEvent( QShowEvent *event ) Q_DECL_OVERRIDE;
+    void hideEvent( QHideEvent *event ) Q_DECL_OVERRIDE;
 
  private:
     struct KTimerPrefPrivate *d;
@@ -0,0 +1,348 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerarchive.h"
+#include "ktimersnapshot.h"
+
+#include <string.h>
+
+#include <QDataStream>
+#include <QIODevice>
+#include <KConfig>
+#include <KConfigGroup>
+#include <KLocalizedString>
+
+static const char s_magic[4] = { 'K', 'T', 'J', 'B' };
+static const quint16 s_version = 1;
+// Far above any sane job, low enough that a corrupt size cannot exhaust memory.
+static const quint32 s_maxRecordSize = 1024*1024;
+
+
+KTimerJobRecord::KTimerJobRecord()
+{
+    delay = 100;
+    flags = OneInstance;
+    captureSize = 4;
+    slack = 0;
+    maxRuntime = 0;
+    priority = 2;       // KTimerJob::NormalPriority
+    catchUp = 0;        // KTimerJob::CatchUpOnce
+    maxCatchUp = 10;
+}
+
+
+void KTimerJobRecord::read( const KConfigGroup &groupcfg )
+{
+    delay = groupcfg.readEntry( "Delay", 100u );
+    command = groupcfg.readPathEntry( "Command", QString() );
+    onSchedule = groupcfg.readPathEntry( "OnSchedule", QString() );
+    onPause = groupcfg.readPathEntry( "OnPause", QString() );
+    onResume = groupcfg.readPathEntry( "OnResume", QString() );
+    onStop = groupcfg.readPathEntry( "OnStop", QString() );
+    onSuccess = groupcfg.readPathEntry( "OnSuccess", QString() );
+    onFailure = groupcfg.readPathEntry( "OnFailure", QString() );
+
+    flags = 0;
+    if( groupcfg.readEntry( "Loop", false ) )
+        flags |= Loop;
+    if( groupcfg.readEntry( "OneInstance", true ) )
+        flags |= OneInstance;
+    if( groupcfg.readEntry( "Consecutive", false ) )
+        flags |= Consecutive;
+    if( groupcfg.readEntry( "Batch", false ) )
+        flags |= Batch;
+    if( groupcfg.readEntry( "Coprocess", false ) )
+        flags |= Coprocess;
+    if( groupcfg.readEntry( "PipeOutput", false ) )
+        flags |= PipeOutput;
+
+    captureSize = groupcfg.readEntry( "CaptureSize", 4u );
+    slack = groupcfg.readEntry( "Slack", 0u );
+    maxRuntime = groupcfg.readEntry( "MaxRuntime", 0u );
+    priority = groupcfg.readEntry( "Priority", 2 );
+    group = groupcfg.readEntry( "Group", QString() );
+    catchUp = groupcfg.readEntry( "CatchUp", 0 );
+    maxCatchUp = groupcfg.readEntry( "MaxCatchUp", 10u );
+}
+
+
+void KTimerJobRecord::write( KConfigGroup &groupcfg ) const
+{
+    groupcfg.writeEntry( "Delay", delay );
+    groupcfg.writePathEntry( "Command", command );
+    groupcfg.writePathEntry( "OnSchedule", onSchedule );
+    groupcfg.writePathEntry( "OnPause", onPause );
+    groupcfg.writePathEntry( "OnResume", onResume );
+    groupcfg.writePathEntry( "OnStop", onStop );
+    groupcfg.writePathEntry( "OnSuccess", onSuccess );
+    groupcfg.writePathEntry( "OnFailure", onFailure );
+    groupcfg.writeEntry( "Loop", bool( flags & Loop ) );
+    groupcfg.writeEntry( "OneInstance", bool( flags & OneInstance ) );
+    groupcfg.writeEntry( "Consecutive", bool( flags & Consecutive ) );
+    groupcfg.writeEntry( "Batch", bool( flags & Batch ) );
+    groupcfg.writeEntry( "Coprocess", bool( flags & Coprocess ) );
+    groupcfg.writeEntry( "PipeOutput", bool( flags & PipeOutput ) );
+    groupcfg.writeEntry( "CaptureSize", captureSize );
+    groupcfg.writeEntry( "Slack", slack );
+    groupcfg.writeEntry( "MaxRuntime", maxRuntime );
+    groupcfg.writeEntry( "Priority", priority );
+    groupcfg.writeEntry( "Group", group );
+    groupcfg.writeEntry( "CatchUp", catchUp );
+    groupcfg.writeEntry( "MaxCatchUp", maxCatchUp );
+}
+
+
+void KTimerJobRecord::read( const KTimerSnapshot &snapshot, int index )
+{
+    const KTimerSnapshot::Entry &entry = snapshot.entry( index );
+    delay = entry.delay;
+    flags = entry.flags;        // the same bits
+    captureSize = entry.captureSize;
+    slack = entry.slack;
+    maxRuntime = entry.maxRuntime;
+    priority = entry.priority;
+    command = snapshot.string( index, KTimerSnapshot::Command );
+    onSchedule = snapshot.string( index, KTimerSnapshot::OnSchedule );
+    onPause = snapshot.string( index, KTimerSnapshot::OnPause );
+    onResume = snapshot.string( index, KTimerSnapshot::OnResume );
+    onStop = snapshot.string( index, KTimerSnapshot::OnStop );
+    onSuccess = snapshot.string( index, KTimerSnapshot::OnSuccess );
+    onFailure = snapshot.string( index, KTimerSnapshot::OnFailure );
+    group = snapshot.string( index, KTimerSnapshot::Group );
+    catchUp = entry.catchUp;
+    maxCatchUp = entry.maxCatchUp;
+}
+
+
+/***************************************************************/
+
+
+KTimerJobWriter::KTimerJobWriter( QIODevice *device )
+{
+    m_device = device;
+    m_started = false;
+}
+
+
+bool KTimerJobWriter::write( const KTimerJobRecord &record )
+{
+    if( !m_error.isEmpty() )
+        return false;
+
+    m_buffer.clear();
+    QDataStream out( &m_buffer, QIODevice::WriteOnly );
+    out.setVersion( QDataStream::Qt_5_5 );
+
+    if( !m_started ) {
+        out.writeRawData( s_magic, sizeof( s_magic ) );
+        out << s_version << quint16( 0 );
+        m_started = true;
+    }
+
+    // Reserve the size, fill it in once the record is written.
+    const int begin = m_buffer.size();
+    out << quint32( 0 );
+    out << record.delay << record.flags << record.captureSize << record.slack << record.maxRuntime << record.priority;
+    out << record.command.toUtf8() << record.onSchedule.toUtf8() << record.onPause.toUtf8() << record.onResume.toUtf8()
+        << record.onStop.toUtf8() << record.onSuccess.toUtf8() << record.onFailure.toUtf8() << record.group.toUtf8();
+    out << record.catchUp << record.maxCatchUp;
+
+    const quint32 size = m_buffer.size() - begin - sizeof( quint32 );
+    out.device()->seek( begin );
+    out << size;
+
+    if( m_device->write( m_buffer )!=m_buffer.size() ) {
+        m_error = m_device->errorString();
+        return false;
+    }
+    return true;
+}
+
+
+bool KTimerJobWriter::finish()
+{
+    if( !m_error.isEmpty() )
+        return false;
+
+    m_buffer.clear();
+    QDataStream out( &m_buffer, QIODevice::WriteOnly );
+    if( !m_started ) {
+        out.writeRawData( s_magic, sizeof( s_magic ) );
+        out << s_version << quint16( 0 );
+        m_started = true;
+    }
+    out << quint32( 0 );
+
+    if( m_device->write( m_buffer )!=m_buffer.size() ) {
+        m_error = m_device->errorString();
+        return false;
+    }
+    return true;
+}
+
+
+int KTimerJobWriter::writeAll( KConfig *cfg )
+{
+    const KConfigGroup jobscfg = cfg->group( "Jobs" );
+    const int num = jobscfg.readEntry( "Number", 0 );
+
+    // See KTimerJobStore::load().
+    KTimerSnapshot snapshot;
+    int fromSnapshot = 0;
+    if( jobscfg.readEntry( "Snapshot", false ) && jobscfg.hasKey( "SnapshotStamp" ) ) {
+        if( !snapshot.open( KTimerSnapshot::defaultPath(), jobscfg.readEntry( "SnapshotStamp", quint64( 0 ) ) ) ) {
+            m_error = i18n( "The job snapshot %1 is missing or damaged.", KTimerSnapshot::defaultPath() );
+            return -1;
+        }
+        fromSnapshot = qMin( snapshot.count(), num );
+    }
+
+    KTimerJobRecord record;
+    for( int n=0; n<num; n++ ) {
+        if( n<fromSnapshot )
+            record.read( snapshot, n );
+        else
+            record.read( cfg->group( QStringLiteral( "Job%1" ).arg( n ) ) );
+        if( !write( record ) )
+            return -1;
+    }
+    return finish() ? num : -1;
+}
+
+
+QString KTimerJobWriter::errorString() const
+{
+    return m_error;
+}
+
+
+/***************************************************************/
+
+
+KTimerJobReader::KTimerJobReader( QIODevice *device )
+{
+    m_device = device;
+    m_started = false;
+    m_done = false;
+}
+
+
+bool KTimerJobReader::readNext( KTimerJobRecord *record )
+{
+    if( m_done )
+        return false;
+
+    QDataStream in( m_device );
+    in.setVersion( QDataStream::Qt_5_5 );
+
+    if( !m_started ) {
+        char magic[sizeof( s_magic )];
+        quint16 version, reserved;
+        if( in.readRawData( magic, sizeof( magic ) )!=int( sizeof( magic ) ) || memcmp( magic, s_magic, sizeof( magic ) )!=0 )
+            return fail( i18n( "Not a ktimer archive." ) );
+        in >> version >> reserved;
+        if( in.status()!=QDataStream::Ok )
+            return fail( i18n( "Not a ktimer archive." ) );
+        if( version!=s_version )
+            return fail( i18n( "Unsupported archive version %1.", version ) );
+        m_started = true;
+    }
+
+    quint32 size;
+    in >> size;
+    if( in.status()!=QDataStream::Ok )
+        return fail( i18n( "The archive is truncated." ) );
+    if( size==0 ) {
+        m_done = true;
+        return false;
+    }
+    if( size>s_maxRecordSize )
+        return fail( i18n( "The archive is corrupt." ) );
+
+    // One buffer, reused for every record.
+    m_buffer.resize( size );
+    if( in.readRawData( m_buffer.data(), size )!=int( size ) )
+        return fail( i18n( "The archive is truncated." ) );
+
+    QDataStream fields( m_buffer );
+    fields.setVersion( QDataStream::Qt_5_5 );
+    QByteArray command, onSchedule, onPause, onResume, onStop, onSuccess, onFailure, group;
+    fields >> record->delay >> record->flags >> record->captureSize >> record->slack >> record->maxRuntime >> record->priority;
+    fields >> command >> onSchedule >> onPause >> onResume >> onStop >> onSuccess >> onFailure >> group;
+    if( fields.status()!=QDataStream::Ok )
+        return fail( i18n( "The archive is corrupt." ) );
+
+    // Appended later, missing from older archives.
+    record->catchUp = 0;
+    record->maxCatchUp = 10;
+    if( !fields.atEnd() )
+        fields >> record->catchUp >> record->maxCatchUp;
+    if( fields.status()!=QDataStream::Ok )
+        return fail( i18n( "The archive is corrupt." ) );
+    // Whatever follows was added by a later ktimer.
+
+    record->command = QString::fromUtf8( command );
+    record->onSchedule = QString::fromUtf8( onSchedule );
+    record->onPause = QString::fromUtf8( onPause );
+    record->onResume = QString::fromUtf8( onResume );
+    record->onStop = QString::fromUtf8( onStop );
+    record->onSuccess = QString::fromUtf8( onSuccess );
+    record->onFailure = QString::fromUtf8( onFailure );
+    record->group = QString::fromUtf8( group );
+    return true;
+}
+
+
+int KTimerJobReader::readAll( KConfig *cfg )
+{
+    KConfigGroup jobscfg = cfg->group( "Jobs" );
+    const int first = jobscfg.readEntry( "Number", 0 );
+    int num = first;
+
+    KTimerJobRecord record;
+    while( readNext( &record ) ) {
+        KConfigGroup groupcfg = cfg->group( QStringLiteral( "Job%1" ).arg( num++ ) );
+        groupcfg.deleteGroup();
+        record.write( groupcfg );
+    }
+    if( hasError() )
+        return -1;
+
+    jobscfg.writeEntry( "Number", num );
+    return num-first;
+}
+
+
+bool KTimerJobReader::hasError() const
+{
+    return !m_error.isEmpty();
+}
+
+
+QString KTimerJobReader::errorString() const
+{
+    return m_error;
+}
+
+
+bool KTimerJobReader::fail( const QString &error )
+{
+    m_error = error;
+    m_done = true;
+    return false;
+}
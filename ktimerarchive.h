@@ -0,0 +1,125 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERARCHIVE_H_INCLUDED
+#define KTIMERARCHIVE_H_INCLUDED
+
+#include <QByteArray>
+#include <QString>
+
+class QIODevice;
+class KConfig;
+class KConfigGroup;
+class KTimerSnapshot;
+
+/**
+ * The definition of a job, as exported: what the user set up, not the
+ * state of its countdown nor its id.
+ */
+struct KTimerJobRecord {
+    enum Flag {
+        Loop = 0x01,
+        OneInstance = 0x02,
+        Consecutive = 0x04,
+        Batch = 0x08,
+        Coprocess = 0x10,
+        PipeOutput = 0x20
+    };
+
+    KTimerJobRecord();
+
+    // The same keys as KTimerJob::save() and load().
+    void read( const KConfigGroup &groupcfg );
+    void write( KConfigGroup &groupcfg ) const;
+    void read( const KTimerSnapshot &snapshot, int index );
+
+    quint32 delay;
+    quint32 flags;
+    quint32 captureSize;
+    quint32 slack;
+    quint32 maxRuntime;
+    qint32 priority;
+    QString command;
+    QString onSchedule;
+    QString onPause;
+    QString onResume;
+    QString onStop;
+    QString onSuccess;
+    QString onFailure;
+    QString group;
+    qint32 catchUp;
+    quint32 maxCatchUp;
+};
+
+/**
+ * Writes job records in the ktimer archive format.
+ *
+ * An archive is the magic "KTJB", a 16 bit format version, 16 reserved bits,
+ * and then one record after the other, each prefixed with its size in bytes;
+ * a size of 0 ends the archive. All integers are big-endian. Fields are only
+ * ever appended to a record, and readers skip what they do not know, so the
+ * version only changes when old readers could not make sense of a record.
+ */
+class KTimerJobWriter {
+ public:
+    explicit KTimerJobWriter( QIODevice *device );
+
+    bool write( const KTimerJobRecord &record );
+    // Writes the end marker; an archive without one reads as truncated.
+    bool finish();
+
+    // Writes all jobs saved in cfg or its snapshot by KTimerJobStore, and finishes; returns how many, or -1.
+    int writeAll( KConfig *cfg );
+
+    QString errorString() const;
+
+ private:
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    bool m_started;
+    QString m_error;
+};
+
+/**
+ * Reads an archive written by KTimerJobWriter one record at a time, so
+ * that memory use does not depend on the number of jobs in it.
+ */
+class KTimerJobReader {
+ public:
+    explicit KTimerJobReader( QIODevice *device );
+
+    // False at the end of the archive or on an error, see errorString().
+    bool readNext( KTimerJobRecord *record );
+
+    // Appends all jobs of the archive to those of cfg, stopped; returns how many, or -1.
+    int readAll( KConfig *cfg );
+
+    bool hasError() const;
+    QString errorString() const;
+
+ private:
+    bool fail( const QString &error );
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    bool m_started;
+    bool m_done;
+    QString m_error;
+};
+
+#endif
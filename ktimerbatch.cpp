@@ -0,0 +1,149 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerbatch.h"
+#include "ktimer.h"
+#include "ktimerprocess.h"
+#include "ktimerscheduler.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+
+// Batches that are still collecting jobs, by command.
+static QHash<QString, KTimerBatch *> s_collecting;
+static unsigned s_window = 2;
+
+
+KTimerBatch::KTimerBatch( const QString &command )
+    : QObject( QCoreApplication::instance() )
+{
+    m_command = command;
+    m_process = 0;
+
+    m_timer = new QTimer( this );
+    m_timer->setSingleShot( true );
+    connect(m_timer, &QTimer::timeout, this, &KTimerBatch::launch);
+}
+
+
+KTimerBatch::~KTimerBatch()
+{
+    if( s_collecting.value( m_command )==this )
+        s_collecting.remove( m_command );
+}
+
+
+bool KTimerBatch::enqueue( KTimerJob *job )
+{
+    const QString command = job->command().simplified();
+
+    KTimerBatch *batch = s_collecting.value( command );
+    if( !batch ) {
+        batch = new KTimerBatch( command );
+        s_collecting.insert( command, batch );
+        batch->m_timer->start( s_window*1000 );
+    }
+
+    if( batch->m_jobs.contains( job ) )
+        return false;
+
+    batch->m_jobs.append( job );
+    return true;
+}
+
+
+unsigned KTimerBatch::window()
+{
+    return s_window;
+}
+
+
+void KTimerBatch::setWindow( unsigned sec )
+{
+    s_window = sec;
+}
+
+
+void KTimerBatch::launch()
+{
+    // From here on, jobs firing the same command go into a new batch.
+    s_collecting.remove( m_command );
+
+    // The run may take as long as the most patient job allows.
+    QStringList ids;
+    unsigned maxRuntime = 0;
+    bool limited = true;
+    for( int i=0; i<m_jobs.count(); ++i ) {
+        if( m_jobs.at( i ) ) {
+            ids.append( QString::number( m_jobs.at( i )->id() ) );
+            maxRuntime = qMax( maxRuntime, m_jobs.at( i )->maxRuntime() );
+            limited = limited && m_jobs.at( i )->maxRuntime()>0;
+        }
+    }
+
+    if( ids.isEmpty() ) {
+        deleteLater();
+        return;
+    }
+
+    m_process = new KTimerProcess( this );
+    m_process->setStandardOutputPiped();
+    m_process->setMaxRuntime( limited ? maxRuntime*1000 : 0 );
+    connect(m_process, &KTimerProcess::finished, this, &KTimerBatch::processExited);
+    const bool started = m_process->start( m_command + QLatin1Char( ' ' ) + ids.join( QLatin1Char( ' ' ) ) );
+
+    for( int i=0; i<m_jobs.count(); ++i ) {
+        if( m_jobs.at( i ) )
+            m_jobs.at( i )->delegateFired();
+    }
+
+    if( !started )
+        processExited( -1, QProcess::CrashExit );
+}
+
+
+void KTimerBatch::processExited( int, QProcess::ExitStatus status )
+{
+    // Per-job results reported by the command, "<id> <status>" per line.
+    QHash<unsigned, bool> results;
+    while( m_process->canReadLine() ) {
+        const QList<QByteArray> fields = m_process->readLine().simplified().split( ' ' );
+        if( fields.count()!=2 )
+            continue;
+
+        bool isId;
+        const unsigned id = fields.at( 0 ).toUInt( &isId );
+        if( isId )
+            results.insert( id, fields.at( 1 )=="0" || fields.at( 1 )=="ok" );
+    }
+
+    // The same as for a job run on its own.
+    const bool ok = m_process->succeeded( status );
+    if( m_process->timedOut() )
+        KTimerScheduler::self()->countWatchdogKill();
+    for( int i=0; i<m_jobs.count(); ++i ) {
+        KTimerJob *job = m_jobs.at( i );
+        if( job )
+            job->delegateFinished( results.value( job->id(), ok ) );
+    }
+
+    m_jobs.clear();
+    deleteLater();
+}
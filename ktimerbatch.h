@@ -0,0 +1,69 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERBATCH_H_INCLUDED
+#define KTIMERBATCH_H_INCLUDED
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QProcess>
+
+class QTimer;
+class KTimerJob;
+class KTimerProcess;
+
+/**
+ * One invocation of a command on behalf of several batch jobs.
+ *
+ * Batch jobs (KTimerJob::batch()) that fire the same command within
+ * window() seconds of each other are collected into a single KTimerBatch,
+ * which runs the command once with the ids of all collected jobs appended
+ * as arguments.
+ *
+ * The outcome is mapped back per job: the command may print lines of the
+ * form "<id> <status>" on stdout, a status of "0" or "ok" meaning success.
+ * Jobs that are not mentioned take the outcome of the whole invocation, by
+ * the rule of a job run on its own, see KTimerProcess::succeeded().
+ */
+class KTimerBatch : public QObject {
+ Q_OBJECT
+
+ public:
+    virtual ~KTimerBatch();
+
+    // Returns false if the job is already waiting in the batch for its command.
+    static bool enqueue( KTimerJob *job );
+
+    static unsigned window();
+    static void setWindow( unsigned sec );
+
+ private slots:
+    void launch();
+    void processExited( int exitCode, QProcess::ExitStatus status );
+
+ private:
+    explicit KTimerBatch( const QString &command );
+
+    QString m_command;
+    QList<QPointer<KTimerJob> > m_jobs;
+    QTimer *m_timer;
+    KTimerProcess *m_process;
+};
+
+#endif
@@ -0,0 +1,443 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * ktimer_bench: times the hot paths of ktimer and writes the results as JSON,
+ * one object per benchmark with the time per iteration in nanoseconds.
+ *
+ * It runs under the offscreen platform unless told otherwise, and on a
+ * private configuration (QStandardPaths test mode), so it can run unattended.
+ */
+
+#include "ktimer.h"
+#include "ktimereventlog.h"
+#include "ktimerjobstore.h"
+#include "ktimerprocess.h"
+#include "ktimerscheduler.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QPointer>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <KConfig>
+#include <KConfigGroup>
+
+static qint64 s_minNsecs = 200000000;
+static QJsonArray s_results;
+
+static void report( const QString &name, qint64 iterations, qint64 nsecs, int jobs=0 )
+{
+    QJsonObject result;
+    result.insert( QStringLiteral( "name" ), name );
+    if( jobs )
+        result.insert( QStringLiteral( "jobs" ), jobs );
+    result.insert( QStringLiteral( "iterations" ), double( iterations ) );
+    result.insert( QStringLiteral( "total_ms" ), nsecs / 1e6 );
+    result.insert( QStringLiteral( "ns_per_iteration" ), double( nsecs ) / qMax<qint64>( 1, iterations ) );
+    s_results.append( result );
+
+    QTextStream( stderr ) << name << ( jobs ? QStringLiteral( "/%1" ).arg( jobs ) : QString() ) << ": "
+                          << QString::number( double( nsecs ) / qMax<qint64>( 1, iterations ), 'f', 1 ) << " ns\n";
+}
+
+// Runs body(n) for n = 1, 2, 4, ... until one run took at least the minimum time.
+template<typename Body>
+static void measure( const QString &name, Body body, int perRun=1, int jobs=0 )
+{
+    for( qint64 n=1; ; n*=2 ) {
+        const qint64 nsecs = body( n );
+        if( nsecs>=s_minNsecs || n>=( 1<<30 ) ) {
+            report( name, n*perRun, nsecs, jobs );
+            return;
+        }
+    }
+}
+
+
+// Ends every run right after the wakeup that started it, without forking.
+class BenchLauncher : public KTimerLauncher {
+ public:
+    bool launch( KTimerProcess *proc, const QString & ) Q_DECL_OVERRIDE
+    {
+        m_running.append( proc );
+        return true;
+    }
+
+    void finishAll()
+    {
+        const QList<QPointer<KTimerProcess> > running = m_running;
+        m_running.clear();
+        for( int i=0; i<running.count(); ++i ) {
+            if( running.at( i ) )
+                running.at( i )->setFinished( 0, QProcess::NormalExit, KTimerUsage() );
+        }
+        QCoreApplication::sendPostedEvents( 0, QEvent::DeferredDelete );
+    }
+
+ private:
+    QList<QPointer<KTimerProcess> > m_running;
+};
+
+
+class BenchClock : public KTimerClock {
+ public:
+    BenchClock() : m_now( 0 ) {}
+    qint64 now() const Q_DECL_OVERRIDE { return m_now; }
+    void advance( qint64 msec ) { m_now += msec; }
+
+ private:
+    qint64 m_now;
+};
+
+
+static void writeJobs( const QString &path, int count )
+{
+    QFile::remove( path );
+    KConfig cfg( path, KConfig::SimpleConfig );
+    for( int i=0; i<count; ++i ) {
+        KTimerJob job;
+        job.setDelay( 60 + i % 3600 );
+        job.setCommand( QStringLiteral( "echo job %1" ).arg( i ) );
+        job.setLoop( i % 2 );
+        job.setValue( 1 + i % 60 );
+        job.start();
+        job.save( &cfg, QStringLiteral( "Job%1" ).arg( i ) );
+    }
+    cfg.group( "Jobs" ).writeEntry( "Number", count );
+    cfg.sync();
+}
+
+
+// KTimerJob::timeout() as driven by the scheduler, including the fire of a
+// stubbed command, per expiring job.
+static void benchTimeout( int count )
+{
+    BenchClock clock;
+    BenchLauncher launcher;
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+    scheduler->setClock( &clock );
+    KTimerProcess::setLauncher( &launcher );
+
+    QList<KTimerJob *> jobs;
+    for( int i=0; i<count; ++i ) {
+        KTimerJob *job = new KTimerJob;
+        job->setDelay( 1 );
+        job->setLoop( true );
+        job->setCaptureSize( 0 );
+        job->setCommand( QStringLiteral( "bench" ) );
+        job->start();
+        jobs.append( job );
+    }
+
+    measure( QStringLiteral( "timeout" ), [&]( qint64 n ) {
+        qint64 nsecs = 0;
+        for( qint64 i=0; i<n; ++i ) {
+            clock.advance( 1000 );
+            QElapsedTimer timer;
+            timer.start();
+            scheduler->wakeup();
+            nsecs += timer.nsecsElapsed();
+            launcher.finishAll();
+        }
+        return nsecs;
+    }, count, count );
+
+    qDeleteAll( jobs );
+    KTimerProcess::setLauncher( 0 );
+    scheduler->setClock( 0 );
+}
+
+
+static void benchFormatTime()
+{
+    KTimerJob job;
+    int sink = 0;
+    measure( QStringLiteral( "formatTime" ), [&]( qint64 n ) {
+        QElapsedTimer timer;
+        timer.start();
+        for( qint64 i=0; i<n; ++i )
+            sink += job.formatTime( int( i % 100000 ) ).size();
+        return timer.nsecsElapsed();
+    });
+    Q_UNUSED( sink );
+}
+
+
+// KTimerJobItem::update(), through the refresh of the running countdowns.
+static void benchUpdate( const QString &path, int count )
+{
+    writeJobs( path, count );
+    KConfig cfg( path, KConfig::SimpleConfig );
+    KTimerJobStore store;
+    store.load( &cfg );
+    KTimerPref pref( &store );
+
+    measure( QStringLiteral( "update" ), [&]( qint64 n ) {
+        QElapsedTimer timer;
+        timer.start();
+        for( qint64 i=0; i<n; ++i )
+            QMetaObject::invokeMethod( &pref, "refresh" );
+        return timer.nsecsElapsed();
+    }, count, count );
+}
+
+
+// Parsing the file included; a fresh store for every load.
+static void benchLoadSave( const QString &dir, int count )
+{
+    const QString path = dir + QStringLiteral( "/jobs%1rc" ).arg( count );
+    writeJobs( path, count );
+
+    measure( QStringLiteral( "loadJobs" ), [&]( qint64 n ) {
+        qint64 nsecs = 0;
+        for( qint64 i=0; i<n; ++i ) {
+            KTimerJobStore *store = new KTimerJobStore;
+            QElapsedTimer timer;
+            timer.start();
+            KConfig cfg( path, KConfig::SimpleConfig );
+            store->load( &cfg );
+            nsecs += timer.nsecsElapsed();
+            delete store;
+        }
+        return nsecs;
+    }, 1, count );
+
+    KConfig cfg( path, KConfig::SimpleConfig );
+    KTimerJobStore store;
+    store.load( &cfg );
+    const QString out = dir + QStringLiteral( "/saved%1rc" ).arg( count );
+
+    measure( QStringLiteral( "saveJobs" ), [&]( qint64 n ) {
+        qint64 nsecs = 0;
+        for( qint64 i=0; i<n; ++i ) {
+            QFile::remove( out );
+            QElapsedTimer timer;
+            timer.start();
+            KConfig saved( out, KConfig::SimpleConfig );
+            store.save( &saved );
+            nsecs += timer.nsecsElapsed();
+        }
+        return nsecs;
+    }, 1, count );
+
+    // The same jobs from the snapshot, see KTimerSnapshot.
+    const QString snapshotted = dir + QStringLiteral( "/snapshot%1rc" ).arg( count );
+    {
+        QFile::remove( snapshotted );
+        KConfig saved( snapshotted, KConfig::SimpleConfig );
+        saved.group( "Jobs" ).writeEntry( "Snapshot", true );
+        store.save( &saved );
+    }
+
+    measure( QStringLiteral( "loadJobs_snapshot" ), [&]( qint64 n ) {
+        qint64 nsecs = 0;
+        for( qint64 i=0; i<n; ++i ) {
+            KTimerJobStore *store = new KTimerJobStore;
+            QElapsedTimer timer;
+            timer.start();
+            KConfig cfg( snapshotted, KConfig::SimpleConfig );
+            store->load( &cfg );
+            nsecs += timer.nsecsElapsed();
+            delete store;
+        }
+        return nsecs;
+    }, 1, count );
+}
+
+
+// Cold start as main() does it, up to the first paint of the window, or
+// without the window as with --tray.
+static void benchStartup( const QString &dir, int count )
+{
+    const QString path = dir + QStringLiteral( "/jobs%1rc" ).arg( count );
+    writeJobs( path, count );
+
+    for( int window=0; window<2; ++window ) {
+        measure( window ? QStringLiteral( "startup_window" ) : QStringLiteral( "startup_tray" ), [&]( qint64 n ) {
+            qint64 nsecs = 0;
+            for( qint64 i=0; i<n; ++i ) {
+                QElapsedTimer timer;
+                timer.start();
+                KTimerJobStore *store = new KTimerJobStore;
+                KConfig cfg( path, KConfig::SimpleConfig );
+                store->load( &cfg );
+                KTimerPref *pref = 0;
+                if( window ) {
+                    pref = new KTimerPref( store );
+                    pref->show();
+                    QCoreApplication::processEvents();
+                }
+                nsecs += timer.nsecsElapsed();
+                delete pref;
+                delete store;
+            }
+            return nsecs;
+        }, 1, count );
+    }
+}
+
+
+// Appending to the event log, and finding the runs of one job over a tenth
+// of a full log of a million events.
+static void benchEventLog( const QString &dir )
+{
+    const quint32 capacity = 1u<<20;
+    KTimerEventLog log;
+    if( !log.open( dir + QStringLiteral( "/events.log" ), capacity ) ) {
+        QTextStream( stderr ) << "eventlog: cannot create the log, skipped\n";
+        return;
+    }
+
+    KTimerEvent event = { 0, 0, KTimerEvent::Succeeded, 0, 10 };
+    measure( QStringLiteral( "eventlog_append" ), [&]( qint64 n ) {
+        QElapsedTimer timer;
+        timer.start();
+        for( qint64 i=0; i<n; ++i ) {
+            event.time += 7;
+            event.job = i % 1000 + 1;
+            log.append( event );
+        }
+        return timer.nsecsElapsed();
+    });
+
+    while( log.written()<capacity ) {
+        event.time += 7;
+        event.job = log.written() % 1000 + 1;
+        log.append( event );
+    }
+    const qint64 until = event.time;
+    const qint64 since = until - qint64( capacity/10 ) * 7;
+
+    int found = 0;
+    measure( QStringLiteral( "eventlog_query" ), [&]( qint64 n ) {
+        QElapsedTimer timer;
+        timer.start();
+        for( qint64 i=0; i<n; ++i )
+            found = log.query( 500, since, until ).count();
+        return timer.nsecsElapsed();
+    }, 1, capacity );
+    Q_UNUSED( found );
+}
+
+
+// From fire() to the child having exec()ed, and on to its exit being noticed.
+static void benchFire()
+{
+    const QString program = QStandardPaths::findExecutable( QStringLiteral( "true" ) );
+    if( program.isEmpty() ) {
+        QTextStream( stderr ) << "fire: no true(1), skipped\n";
+        return;
+    }
+
+    KTimerJob job;
+    job.setCommand( program );
+    QEventLoop loop;
+    bool done = false;
+    QObject::connect(&job, &KTimerJob::finished, &loop, [&]() {
+        done = true;
+        loop.quit();
+    });
+
+    qint64 exited = 0;
+    measure( QStringLiteral( "fire" ), [&]( qint64 n ) {
+        qint64 nsecs = 0;
+        exited = 0;
+        for( qint64 i=0; i<n; ++i ) {
+            QElapsedTimer timer;
+            timer.start();
+            done = false;
+            QMetaObject::invokeMethod( &job, "fire" );
+            nsecs += timer.nsecsElapsed();
+            // NB: a command that failed to start has finished already.
+            if( !done )
+                loop.exec();
+            exited += timer.nsecsElapsed();
+        }
+        return nsecs;
+    });
+
+    const QJsonObject fire = s_results.last().toObject();
+    report( QStringLiteral( "fire_to_exit" ), qint64( fire.value( QStringLiteral( "iterations" ) ).toDouble() ), exited );
+}
+
+
+int main( int argc, char **argv )
+{
+    if( qEnvironmentVariableIsEmpty( "QT_QPA_PLATFORM" ) )
+        qputenv( "QT_QPA_PLATFORM", "offscreen" );
+    QStandardPaths::setTestModeEnabled( true );
+
+    QApplication app( argc, argv );
+    QCoreApplication::setApplicationName( QStringLiteral( "ktimer_bench" ) );
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription( QStringLiteral( "Times the hot paths of ktimer and writes the results as JSON." ) );
+    parser.addHelpOption();
+    parser.addOption( QCommandLineOption( QStringLiteral( "output" ), QStringLiteral( "Write the JSON here instead of to stdout." ), QStringLiteral( "file" ) ) );
+    parser.addOption( QCommandLineOption( QStringLiteral( "sizes" ), QStringLiteral( "Job counts for loading and saving." ), QStringLiteral( "n,..." ), QStringLiteral( "1000,10000,100000" ) ) );
+    parser.addOption( QCommandLineOption( QStringLiteral( "min-time" ), QStringLiteral( "Minimum time of a measurement." ), QStringLiteral( "ms" ), QStringLiteral( "200" ) ) );
+    parser.process( app );
+
+    s_minNsecs = qMax( 1, parser.value( QStringLiteral( "min-time" ) ).toInt() ) * 1000000LL;
+
+    QTemporaryDir dir;
+    if( !dir.isValid() ) {
+        QTextStream( stderr ) << "cannot create a temporary directory\n";
+        return 1;
+    }
+
+    benchTimeout( 1000 );
+    benchFormatTime();
+    benchUpdate( dir.path() + QStringLiteral( "/updaterc" ), 1000 );
+    const QStringList sizes = parser.value( QStringLiteral( "sizes" ) ).split( QLatin1Char( ',' ), QString::SkipEmptyParts );
+    for( int i=0; i<sizes.count(); ++i )
+        benchLoadSave( dir.path(), qMax( 1, sizes.at( i ).toInt() ) );
+    for( int i=0; i<sizes.count(); ++i )
+        benchStartup( dir.path(), qMax( 1, sizes.at( i ).toInt() ) );
+    benchEventLog( dir.path() );
+    benchFire();
+
+    QJsonObject root;
+    root.insert( QStringLiteral( "qt" ), QString::fromLatin1( qVersion() ) );
+    root.insert( QStringLiteral( "cpu" ), QSysInfo::currentCpuArchitecture() );
+    root.insert( QStringLiteral( "kernel" ), QSysInfo::kernelVersion() );
+    root.insert( QStringLiteral( "benchmarks" ), s_results );
+    const QByteArray json = QJsonDocument( root ).toJson();
+
+    if( parser.isSet( QStringLiteral( "output" ) ) ) {
+        QFile file( parser.value( QStringLiteral( "output" ) ) );
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) || file.write( json )!=json.size() ) {
+            QTextStream( stderr ) << "cannot write " << file.fileName() << "\n";
+            return 1;
+        }
+    } else {
+        QTextStream( stdout ) << json;
+    }
+
+    return 0;
+}
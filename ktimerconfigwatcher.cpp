@@ -0,0 +1,180 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerconfigwatcher.h"
+#include "ktimer_debug.h"
+
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#endif
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <KConfig>
+
+// Calls back for every group of an INI file: its header line, and where its
+// text (header included) starts and ends. Text before the first header comes
+// with an empty header.
+template<typename Callback>
+static void splitGroups( const QByteArray &data, Callback callback )
+{
+    QByteArray header;
+    int begin = 0;
+    int pos = 0;
+    while( pos < data.size() ) {
+        int eol = data.indexOf( '\n', pos );
+        if( eol<0 )
+            eol = data.size();
+
+        int first = pos;
+        while( first<eol && ( data.at( first )==' ' || data.at( first )=='\t' ) )
+            ++first;
+        if( first<eol && data.at( first )=='[' ) {
+            if( pos>begin || !header.isEmpty() )
+                callback( header, begin, pos );
+            header = data.mid( first, eol-first ).trimmed();
+            begin = pos;
+        }
+
+        pos = eol+1;
+    }
+    if( data.size()>begin || !header.isEmpty() )
+        callback( header, begin, data.size() );
+}
+
+
+KTimerConfigWatcher::KTimerConfigWatcher( const QString &path, QObject *parent )
+    : QObject( parent )
+{
+    m_path = path;
+    m_fileName = QFile::encodeName( QFileInfo( path ).fileName() );
+    m_fd = -1;
+    m_notifier = 0;
+
+    m_settle = new QTimer( this );
+    m_settle->setSingleShot( true );
+    m_settle->setInterval( 200 );
+    connect(m_settle, &QTimer::timeout, this, &KTimerConfigWatcher::rescan);
+
+#ifdef Q_OS_LINUX
+    // The directory, not the file: saving replaces the file by renaming a new one over it.
+    m_fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( m_fd>=0 && inotify_add_watch( m_fd, QFile::encodeName( QFileInfo( path ).absolutePath() ).constData(),
+                                      IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE )<0 ) {
+        qCWarning(KTIMER_LOG) << "cannot watch" << path;
+        ::close( m_fd );
+        m_fd = -1;
+    }
+    if( m_fd>=0 ) {
+        m_notifier = new QSocketNotifier( m_fd, QSocketNotifier::Read, this );
+        connect(m_notifier, &QSocketNotifier::activated, this, &KTimerConfigWatcher::readEvents);
+    }
+#endif
+
+    sync();
+}
+
+
+KTimerConfigWatcher::~KTimerConfigWatcher()
+{
+    delete m_notifier;
+    if( m_fd>=0 )
+        ::close( m_fd );
+}
+
+
+void KTimerConfigWatcher::sync()
+{
+    QFile file( m_path );
+    const QByteArray data = file.open( QIODevice::ReadOnly ) ? file.readAll() : QByteArray();
+
+    m_hashes.clear();
+    splitGroups( data, [&]( const QByteArray &header, int begin, int end ) {
+        m_hashes.insert( header, qHashBits( data.constData()+begin, end-begin ) );
+    });
+}
+
+
+void KTimerConfigWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool relevant = false;
+    ssize_t got;
+    while( ( got = ::read( m_fd, buffer, sizeof( buffer ) ) )>0 ) {
+        for( char *p = buffer; p < buffer+got; ) {
+            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>( p );
+            if( event->len && m_fileName==event->name )
+                relevant = true;
+            p += sizeof( struct inotify_event ) + event->len;
+        }
+    }
+
+    // Let a burst of writes settle before looking.
+    if( relevant )
+        m_settle->start();
+#endif
+}
+
+
+void KTimerConfigWatcher::rescan()
+{
+    QFile file( m_path );
+    if( !file.open( QIODevice::ReadOnly ) )
+        return;     // most likely in the middle of being replaced, another event follows
+    const QByteArray data = file.readAll();
+
+    QHash<QByteArray, uint> hashes;
+    QByteArray changed;
+    splitGroups( data, [&]( const QByteArray &header, int begin, int end ) {
+        const uint hash = qHashBits( data.constData()+begin, end-begin );
+        hashes.insert( header, hash );
+
+        QHash<QByteArray, uint>::const_iterator it = m_hashes.constFind( header );
+        if( it==m_hashes.constEnd() || it.value()!=hash ) {
+            changed.append( data.constData()+begin, end-begin );
+            if( !changed.endsWith( '\n' ) )
+                changed.append( '\n' );
+        }
+    });
+
+    QStringList removed;
+    for( QHash<QByteArray, uint>::const_iterator it = m_hashes.constBegin(); it != m_hashes.constEnd(); ++it ) {
+        if( !it.key().isEmpty() && !hashes.contains( it.key() ) )
+            removed.append( QString::fromUtf8( it.key().mid( 1, it.key().lastIndexOf( ']' )-1 ) ) );
+    }
+
+    m_hashes = hashes;
+    if( changed.isEmpty() && removed.isEmpty() )
+        return;
+
+    // KConfig only reads files, give it one with nothing but the changes.
+    QTemporaryFile scratch;
+    if( !scratch.open() || scratch.write( changed )!=changed.size() || !scratch.flush() ) {
+        qCWarning(KTIMER_LOG) << "cannot stage the changes of" << m_path;
+        return;
+    }
+
+    KConfig changes( scratch.fileName(), KConfig::SimpleConfig );
+    qCDebug(KTIMER_LOG) << m_path << "changed:" << changes.groupList() << "removed:" << removed;
+    emit changed( &changes, removed );
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERCONFIGWATCHER_H_INCLUDED
+#define KTIMERCONFIGWATCHER_H_INCLUDED
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+
+class QSocketNotifier;
+class QTimer;
+class KConfig;
+
+/**
+ * Notices changes made to a config file behind our back.
+ *
+ * The directory of the file is watched with inotify, since KConfig replaces
+ * the file rather than writing to it. On a change the file is split into its
+ * groups without parsing them, and only the groups whose raw text differs
+ * from the last scan are handed to KConfig, through a scratch file holding
+ * just those groups. Apart from reading the file, the cost of a reload thus
+ * follows the size of the change, not the number of jobs.
+ */
+class KTimerConfigWatcher : public QObject {
+ Q_OBJECT
+
+ public:
+    explicit KTimerConfigWatcher( const QString &path, QObject *parent=0 );
+    virtual ~KTimerConfigWatcher();
+
+    // Takes the file as it is now as the reference, e.g. after writing it ourselves.
+    void sync();
+
+ signals:
+    // 'changes' holds only the groups that were added or modified and is
+    // valid during the emission; 'removed' names groups that are gone.
+    void changed( KConfig *changes, const QStringList &removed );
+
+ private slots:
+    void readEvents();
+    void rescan();
+
+ private:
+    QString m_path;
+    QByteArray m_fileName;
+    int m_fd;
+    QSocketNotifier *m_notifier;
+    QTimer *m_settle;
+    QHash<QByteArray, uint> m_hashes;   // group header -> hash of its text
+};
+
+#endif
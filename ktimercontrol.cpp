@@ -0,0 +1,137 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimercontrol.h"
+#include "ktimer.h"
+#include "ktimergroup.h"
+#include "ktimerscheduler.h"
+
+#include <limits.h>
+
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QDBusMetaType>
+
+KTimerControl::KTimerControl( QObject *parent )
+    : QObject( parent )
+{
+    qDBusRegisterMetaType<QList<uint> >();
+    QDBusConnection::sessionBus().registerObject( QStringLiteral( "/Control" ), this,
+                                                  QDBusConnection::ExportScriptableSlots );
+}
+
+
+KTimerControl::~KTimerControl()
+{
+}
+
+
+QString KTimerControl::output( uint id )
+{
+    KTimerJob *job = KTimerJob::find( id );
+    return job ? QString::fromLocal8Bit( job->capturedOutput() ) : QString();
+}
+
+
+QString KTimerControl::errors( uint id )
+{
+    KTimerJob *job = KTimerJob::find( id );
+    return job ? QString::fromLocal8Bit( job->capturedErrors() ) : QString();
+}
+
+
+QString KTimerControl::usage( uint id )
+{
+    KTimerJob *job = KTimerJob::find( id );
+    return job ? job->usageSummary() : QString();
+}
+
+
+qulonglong KTimerControl::watchdogKills()
+{
+    return KTimerScheduler::self()->watchdogKills();
+}
+
+
+QStringList KTimerControl::groups()
+{
+    return KTimerGroup::names();
+}
+
+
+KTimerGroup *KTimerControl::findGroup( const QString &name )
+{
+    KTimerGroup *group = KTimerGroup::find( name );
+    if( !group && calledFromDBus() )
+        sendErrorReply( QDBusError::InvalidArgs, QStringLiteral( "No such group: %1" ).arg( name ) );
+    return group;
+}
+
+
+void KTimerControl::pauseGroup( const QString &name )
+{
+    if( KTimerGroup *group = findGroup( name ) )
+        group->pause();
+}
+
+
+void KTimerControl::resumeGroup( const QString &name )
+{
+    if( KTimerGroup *group = findGroup( name ) )
+        group->resume();
+}
+
+
+void KTimerControl::stopGroup( const QString &name )
+{
+    if( KTimerGroup *group = findGroup( name ) )
+        group->stop();
+}
+
+
+QList<uint> KTimerControl::upcoming( uint seconds, uint limit )
+{
+    const QList<KTimerJob *> jobs = KTimerScheduler::self()->upcoming( seconds*1000LL, limit ? (int)qMin( limit, (uint)INT_MAX ) : -1 );
+    QList<uint> ids;
+    ids.reserve( jobs.count() );
+    for( int i=0; i<jobs.count(); ++i )
+        ids.append( jobs.at( i )->id() );
+    return ids;
+}
+
+
+qlonglong KTimerControl::dueIn( uint id )
+{
+    KTimerJob *job = KTimerJob::find( id );
+    const qint64 expiry = job ? KTimerScheduler::self()->expiry( job ) : -1;
+    return expiry<0 ? -1 : qMax<qint64>( 0, expiry - KTimerScheduler::self()->now() );
+}
+
+
+QList<uint> KTimerControl::jobsInState( int state )
+{
+    QList<uint> ids;
+    if( state<KTimerJob::Stopped || state>KTimerJob::Started )
+        return ids;
+
+    const QList<KTimerJob *> jobs = KTimerJob::jobs( (KTimerJob::States)state );
+    ids.reserve( jobs.count() );
+    for( int i=0; i<jobs.count(); ++i )
+        ids.append( jobs.at( i )->id() );
+    return ids;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERCONTROL_H_INCLUDED
+#define KTIMERCONTROL_H_INCLUDED
+
+#include <QDBusContext>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+class KTimerGroup;
+
+/**
+ * The D-Bus control interface of ktimer, at /Control.
+ *
+ * Jobs are addressed by their id (KTimerJob::id()). Naming a group that
+ * does not exist is an error, it does not create the group.
+ */
+class KTimerControl : public QObject, protected QDBusContext {
+ Q_OBJECT
+ Q_CLASSINFO("D-Bus Interface", "org.kde.ktimer.Control")
+
+ public:
+    explicit KTimerControl( QObject *parent=0 );
+    virtual ~KTimerControl();
+
+ public slots:
+    // The captured tail of stdout and stderr of the last fire of a job.
+    Q_SCRIPTABLE QString output( uint id );
+    Q_SCRIPTABLE QString errors( uint id );
+    // Resource usage statistics of the command and hooks of a job.
+    Q_SCRIPTABLE QString usage( uint id );
+    // Runs killed for exceeding their maximum runtime since startup.
+    Q_SCRIPTABLE qulonglong watchdogKills();
+
+    // Job groups by name, the empty name meaning all jobs; see KTimerGroup.
+    Q_SCRIPTABLE QStringList groups();
+    Q_SCRIPTABLE void pauseGroup( const QString &name );
+    Q_SCRIPTABLE void resumeGroup( const QString &name );
+    Q_SCRIPTABLE void stopGroup( const QString &name );
+
+    // Ids of the jobs running out within the next 'seconds', soonest first, at most 'limit' (0 for all).
+    Q_SCRIPTABLE QList<uint> upcoming( uint seconds, uint limit );
+    // Milliseconds until the job runs out, -1 if it is not counting down.
+    Q_SCRIPTABLE qlonglong dueIn( uint id );
+    // Ids of the jobs in a state: 0 stopped, 1 paused, 2 started.
+    Q_SCRIPTABLE QList<uint> jobsInState( int state );
+
+ private:
+    // The group of that name, or 0 after replying with an error.
+    KTimerGroup *findGroup( const QString &name );
+};
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimercoprocess.h"
+#include "ktimer.h"
+#include "ktimerprocess.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QTimer>
+
+// Running workers, by command.
+static QHash<QString, KTimerCoprocess *> s_workers;
+
+
+KTimerCoprocess::KTimerCoprocess( const QString &command )
+    : QObject( QCoreApplication::instance() )
+{
+    m_command = command;
+    m_refs = 0;
+    m_crashes = 0;
+
+    m_process = new KTimerProcess( this );
+    m_process->setStandardInputPiped();
+    m_process->setStandardOutputPiped();
+    connect(m_process, &KTimerProcess::readyReadStandardOutput, this, &KTimerCoprocess::readReplies);
+    connect(m_process, &KTimerProcess::finished, this, &KTimerCoprocess::processExited);
+
+    m_restart = new QTimer( this );
+    m_restart->setSingleShot( true );
+    connect(m_restart, &QTimer::timeout, this, &KTimerCoprocess::start);
+}
+
+
+KTimerCoprocess::~KTimerCoprocess()
+{
+    if( s_workers.value( m_command )==this )
+        s_workers.remove( m_command );
+}
+
+
+KTimerCoprocess *KTimerCoprocess::acquire( const QString &command )
+{
+    KTimerCoprocess *worker = s_workers.value( command );
+    if( !worker ) {
+        worker = new KTimerCoprocess( command );
+        s_workers.insert( command, worker );
+        worker->start();
+    }
+
+    worker->m_refs++;
+    return worker;
+}
+
+
+void KTimerCoprocess::release( KTimerCoprocess *worker )
+{
+    if( --worker->m_refs > 0 )
+        return;
+
+    // Nobody fires into this worker anymore: let it see EOF on stdin and go
+    // away on its own, but do not wait for it forever.
+    s_workers.remove( worker->m_command );
+    worker->m_restart->stop();
+
+    // Nothing will be waiting for the answers still to come.
+    worker->readReplies();
+    worker->failPending();
+
+    if( !worker->m_process->isRunning() ) {
+        worker->deleteLater();
+        return;
+    }
+
+    disconnect(worker->m_process, &KTimerProcess::finished, worker, &KTimerCoprocess::processExited);
+    connect(worker->m_process, &KTimerProcess::finished, worker, &KTimerCoprocess::deleteLater);
+    worker->m_process->closeWriteChannel();
+    QTimer::singleShot( 5000, worker, SLOT(deleteLater()) );
+}
+
+
+void KTimerCoprocess::start()
+{
+    if( m_process->isRunning() )
+        return;
+
+    m_restart->stop();
+    if( !m_process->start( m_command ) ) {
+        failPending();
+        restartLater();
+    }
+}
+
+
+void KTimerCoprocess::trigger( KTimerJob *job )
+{
+    job->delegateFired();
+
+    // A worker that keeps crashing is not started again before its delay is up.
+    if( m_restart->isActive() ) {
+        job->delegateFinished( false );
+        return;
+    }
+
+    m_pending.append( job );
+    start();
+    if( m_process->isRunning() )
+        m_process->write( QByteArray::number( job->id() ) + '\n' );
+}
+
+
+void KTimerCoprocess::forget( KTimerJob *job )
+{
+    for( int i=0; i<m_pending.count(); ++i ) {
+        if( m_pending.at( i )==job )
+            m_pending[i].clear();
+    }
+}
+
+
+void KTimerCoprocess::readReplies()
+{
+    while( m_process->canReadLine() ) {
+        const QByteArray reply = m_process->readLine().trimmed();
+        if( m_pending.isEmpty() )
+            continue;
+
+        m_crashes = 0;
+        KTimerJob *job = m_pending.takeFirst();
+        if( job )
+            job->delegateFinished( reply=="0" || reply=="ok" );
+    }
+}
+
+
+void KTimerCoprocess::processExited( int, QProcess::ExitStatus )
+{
+    readReplies();
+    failPending();
+    restartLater();
+}
+
+
+void KTimerCoprocess::restartLater()
+{
+    // 1s, 2s, 4s, ... about a minute between restarts of a crashing worker.
+    m_restart->start( 1000 * ( 1 << qMin( m_crashes, 6 ) ) );
+    m_crashes++;
+}
+
+
+void KTimerCoprocess::failPending()
+{
+    const QList<QPointer<KTimerJob> > pending = m_pending;
+    m_pending.clear();
+
+    for( int i=0; i<pending.count(); ++i ) {
+        if( pending.at( i ) )
+            pending.at( i )->delegateFinished( false );
+    }
+}
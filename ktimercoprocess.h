@@ -0,0 +1,76 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERCOPROCESS_H_INCLUDED
+#define KTIMERCOPROCESS_H_INCLUDED
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QProcess>
+
+class QTimer;
+class KTimerJob;
+class KTimerProcess;
+
+/**
+ * A long-lived worker process shared by all coprocess jobs
+ * (KTimerJob::coprocess()) with the same command.
+ *
+ * Instead of starting the command each time a job fires, the id of the job
+ * is written as one line to the stdin of the worker. The worker answers
+ * every such trigger, in order, with one status line on stdout: "0" or
+ * "ok" means success, anything else failure. Its stderr is passed through.
+ *
+ * If the worker exits (or cannot be started) while jobs still use it, the triggers it did not
+ * answer fail and it is started again after a short, growing delay. Triggers
+ * within that delay fail at once. Once the last job released the worker, the
+ * triggers it did not answer yet fail as well.
+ */
+class KTimerCoprocess : public QObject {
+ Q_OBJECT
+
+ public:
+    virtual ~KTimerCoprocess();
+
+    static KTimerCoprocess *acquire( const QString &command );
+    static void release( KTimerCoprocess *worker );
+
+    void trigger( KTimerJob *job );
+    // Drops the unanswered triggers of a job going away, without telling it.
+    void forget( KTimerJob *job );
+
+ private slots:
+    void start();
+    void readReplies();
+    void processExited( int exitCode, QProcess::ExitStatus status );
+
+ private:
+    explicit KTimerCoprocess( const QString &command );
+    void failPending();
+    void restartLater();
+
+    QString m_command;
+    int m_refs;
+    int m_crashes;
+    KTimerProcess *m_process;
+    QTimer *m_restart;
+    QList<QPointer<KTimerJob> > m_pending;
+};
+
+#endif
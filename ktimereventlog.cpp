@@ -0,0 +1,271 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimereventlog.h"
+#include "ktimer_debug.h"
+#include "ktimerleader.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+struct KTimerEventLogHeader {
+    char magic[4];
+    quint32 version;
+    quint32 slotSize;       // refuses a layout written by a different build
+    quint32 capacity;
+    quint64 head;           // sequence number of the next event
+    char reserved[40];
+};
+
+struct KTimerEventLogSlot {
+    qint64 time;
+    quint32 seq;            // low bits of the sequence number + 1, 0 while written
+    quint32 job;
+    quint32 type;
+    qint32 status;
+    quint32 duration;
+    quint32 reserved;
+};
+
+static const char s_magic[4] = { 'K', 'T', 'E', 'L' };
+static const quint32 s_version = 1;
+
+
+KTimerEventLog::KTimerEventLog()
+{
+    m_map = 0;
+    m_size = 0;
+    m_header = 0;
+    m_slots = 0;
+    m_capacity = 0;
+    m_last = 0;
+}
+
+
+KTimerEventLog::~KTimerEventLog()
+{
+    close();
+}
+
+
+QString KTimerEventLog::defaultPath()
+{
+    return KTimerLeader::defaultDirectory() + QStringLiteral( "/events.log" );
+}
+
+
+bool KTimerEventLog::open( const QString &path, quint32 capacity )
+{
+    close();
+    if( capacity==0 )
+        return false;
+
+    QDir().mkpath( QFileInfo( path ).absolutePath() );
+    const int fd = ::open( QFile::encodeName( path ).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600 );
+    if( fd<0 ) {
+        qCWarning(KTIMER_LOG) << "cannot open the event log" << path;
+        return false;
+    }
+
+    // A fresh file is sparse: only the slots written take up space.
+    const qint64 size = sizeof( KTimerEventLogHeader ) + qint64( capacity ) * sizeof( KTimerEventLogSlot );
+    struct stat st;
+    bool fresh = ::fstat( fd, &st )<0 || st.st_size!=size;
+    if( !fresh ) {
+        KTimerEventLogHeader header;
+        fresh = ::pread( fd, &header, sizeof( header ), 0 )!=(ssize_t)sizeof( header )
+                || memcmp( header.magic, s_magic, sizeof( s_magic ) )!=0 || header.version!=s_version
+                || header.slotSize!=sizeof( KTimerEventLogSlot ) || header.capacity!=capacity;
+    }
+    if( fresh ) {
+        KTimerEventLogHeader header;
+        memset( &header, 0, sizeof( header ) );
+        memcpy( header.magic, s_magic, sizeof( s_magic ) );
+        header.version = s_version;
+        header.slotSize = sizeof( KTimerEventLogSlot );
+        header.capacity = capacity;
+        if( ::ftruncate( fd, 0 )<0 || ::ftruncate( fd, size )<0
+            || ::pwrite( fd, &header, sizeof( header ), 0 )!=(ssize_t)sizeof( header ) ) {
+            qCWarning(KTIMER_LOG) << "cannot create the event log" << path;
+            ::close( fd );
+            return false;
+        }
+    }
+
+    const bool mapped = map( fd, true );
+    ::close( fd );
+    if( mapped && m_header->head>0 )
+        m_last = m_slots[( m_header->head-1 ) % m_capacity].time;
+    return mapped;
+}
+
+
+bool KTimerEventLog::openReadOnly( const QString &path )
+{
+    close();
+    const int fd = ::open( QFile::encodeName( path ).constData(), O_RDONLY | O_CLOEXEC );
+    if( fd<0 )
+        return false;
+
+    const bool mapped = map( fd, false );
+    ::close( fd );
+    return mapped;
+}
+
+
+bool KTimerEventLog::map( int fd, bool writable )
+{
+    struct stat st;
+    if( ::fstat( fd, &st )<0 || st.st_size<(off_t)sizeof( KTimerEventLogHeader ) )
+        return false;
+
+    void *map = ::mmap( 0, st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0 );
+    if( map==MAP_FAILED )
+        return false;
+    m_map = static_cast<uchar *>( map );
+    m_size = st.st_size;
+    m_header = reinterpret_cast<KTimerEventLogHeader *>( m_map );
+
+    if( memcmp( m_header->magic, s_magic, sizeof( s_magic ) )!=0 || m_header->version!=s_version
+        || m_header->slotSize!=sizeof( KTimerEventLogSlot ) || m_header->capacity==0
+        || sizeof( KTimerEventLogHeader ) + quint64( m_header->capacity ) * sizeof( KTimerEventLogSlot )!=quint64( m_size ) ) {
+        close();
+        return false;
+    }
+
+    m_slots = reinterpret_cast<KTimerEventLogSlot *>( m_map + sizeof( KTimerEventLogHeader ) );
+    m_capacity = m_header->capacity;
+    return true;
+}
+
+
+void KTimerEventLog::close()
+{
+    if( m_map )
+        ::munmap( m_map, m_size );
+    m_map = 0;
+    m_size = 0;
+    m_header = 0;
+    m_slots = 0;
+    m_capacity = 0;
+    m_last = 0;
+}
+
+
+bool KTimerEventLog::isOpen() const
+{
+    return m_map!=0;
+}
+
+
+quint32 KTimerEventLog::capacity() const
+{
+    return m_capacity;
+}
+
+
+quint64 KTimerEventLog::written() const
+{
+    return m_header ? __atomic_load_n( &m_header->head, __ATOMIC_ACQUIRE ) : 0;
+}
+
+
+void KTimerEventLog::append( const KTimerEvent &event )
+{
+    if( !m_map )
+        return;
+
+    const quint64 seq = m_header->head;
+    KTimerEventLogSlot &slot = m_slots[seq % m_capacity];
+
+    // Readers see the slot as invalid until it is complete.
+    __atomic_store_n( &slot.seq, 0u, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+
+    // Bisection needs the times in order, whatever the wall clock does.
+    m_last = qMax( m_last, event.time );
+    slot.time = m_last;
+    slot.job = event.job;
+    slot.type = event.type;
+    slot.status = event.status;
+    slot.duration = event.duration;
+    slot.reserved = 0;
+
+    __atomic_store_n( &slot.seq, quint32( seq+1 ), __ATOMIC_RELEASE );
+    __atomic_store_n( &m_header->head, seq+1, __ATOMIC_RELEASE );
+}
+
+
+// False if the slot no longer, or not yet, holds event 'seq'.
+bool KTimerEventLog::read( quint64 seq, KTimerEvent *event ) const
+{
+    const KTimerEventLogSlot &slot = m_slots[seq % m_capacity];
+    if( __atomic_load_n( &slot.seq, __ATOMIC_ACQUIRE )!=quint32( seq+1 ) )
+        return false;
+
+    event->time = slot.time;
+    event->job = slot.job;
+    event->type = slot.type;
+    event->status = slot.status;
+    event->duration = slot.duration;
+
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    return __atomic_load_n( &slot.seq, __ATOMIC_RELAXED )==quint32( seq+1 );
+}
+
+
+QVector<KTimerEvent> KTimerEventLog::query( quint32 job, qint64 since, qint64 until, int limit ) const
+{
+    QVector<KTimerEvent> events;
+    if( !m_map || since>until || limit==0 )
+        return events;
+
+    const quint64 head = written();
+    quint64 lo = head>m_capacity ? head-m_capacity : 0;
+    quint64 hi = head;
+
+    // The first event at or after 'since'; slots overwritten meanwhile count as older.
+    KTimerEvent event;
+    while( lo<hi ) {
+        const quint64 mid = lo + ( hi-lo )/2;
+        if( !read( mid, &event ) || event.time<since )
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+
+    for( quint64 seq=lo; seq<head; ++seq ) {
+        if( !read( seq, &event ) )
+            continue;
+        if( event.time>until )
+            break;
+        if( job && event.job!=job )
+            continue;
+        events.append( event );
+        if( events.count()==limit )
+            break;
+    }
+    return events;
+}
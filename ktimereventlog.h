@@ -0,0 +1,88 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMEREVENTLOG_H_INCLUDED
+#define KTIMEREVENTLOG_H_INCLUDED
+
+#include <QString>
+#include <QVector>
+
+/**
+ * One thing that happened to a job, as kept in the KTimerEventLog.
+ */
+struct KTimerEvent {
+    enum Type { Fired = 1, Succeeded, Failed };
+
+    qint64 time;        // msecs since the epoch
+    quint32 job;        // KTimerJob::id()
+    quint32 type;
+    qint32 status;      // exit code of the run; -1 if it crashed or did not start
+    quint32 duration;   // msecs the run took, if known
+};
+
+/**
+ * What ran and how it went, in a file of fixed size mapped into memory.
+ *
+ * The file holds a header and a ring of capacity() slots; once full, each
+ * event overwrites the oldest. Appending is a handful of stores into the
+ * mapping, no system call, and the kernel writes the pages back when it
+ * sees fit. Events are appended in time order, so a query finds the start
+ * of its time range by bisection and only touches the pages of that range.
+ *
+ * The log may be read while another process writes it: every slot carries
+ * the sequence number it was written under, so slots being overwritten
+ * while read are recognized and skipped.
+ */
+class KTimerEventLog {
+ public:
+    KTimerEventLog();
+    ~KTimerEventLog();
+
+    static QString defaultPath();
+
+    // For appending; a file of another capacity or layout is started afresh.
+    bool open( const QString &path, quint32 capacity );
+    bool openReadOnly( const QString &path );
+    void close();
+    bool isOpen() const;
+
+    quint32 capacity() const;
+    // Events ever appended; the last capacity() of them are kept.
+    quint64 written() const;
+
+    void append( const KTimerEvent &event );
+
+    // The events of the job (0 for all jobs) from 'since' to 'until', both
+    // inclusive, oldest first and at most 'limit' of them (-1 for all).
+    QVector<KTimerEvent> query( quint32 job, qint64 since, qint64 until, int limit=-1 ) const;
+
+ private:
+    Q_DISABLE_COPY(KTimerEventLog)
+
+    bool map( int fd, bool writable );
+    bool read( quint64 seq, KTimerEvent *event ) const;
+
+    uchar *m_map;
+    qint64 m_size;
+    struct KTimerEventLogHeader *m_header;
+    struct KTimerEventLogSlot *m_slots;
+    quint32 m_capacity;
+    qint64 m_last;          // time of the last event appended
+};
+
+#endif
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimergroup.h"
+#include "ktimerprocess.h"
+#include "ktimerscheduler.h"
+
+#include <QCoreApplication>
+#include <QMap>
+#include <KConfig>
+#include <KConfigGroup>
+
+// Named groups by name; the global group is not in here.
+static QMap<QString, KTimerGroup *> s_groups;
+
+KTimerGroup::KTimerGroup( const QString &name, KTimerGroup *parent )
+    : QObject( parent ? static_cast<QObject *>( parent ) : QCoreApplication::instance() )
+{
+    m_name = name;
+    m_parent = parent;
+    m_paused = false;
+    m_pausedAt = 0;
+    m_offset = 0;
+    m_generation = 0;
+}
+
+
+KTimerGroup::~KTimerGroup()
+{
+    if( s_groups.value( m_name )==this )
+        s_groups.remove( m_name );
+}
+
+
+KTimerGroup *KTimerGroup::global()
+{
+    static KTimerGroup *s_global = 0;
+    if( !s_global )
+        s_global = new KTimerGroup( QString(), 0 );
+    return s_global;
+}
+
+
+KTimerGroup *KTimerGroup::group( const QString &name )
+{
+    if( name.isEmpty() )
+        return global();
+
+    KTimerGroup *group = s_groups.value( name );
+    if( !group ) {
+        group = new KTimerGroup( name, global() );
+        s_groups.insert( name, group );
+    }
+    return group;
+}
+
+
+KTimerGroup *KTimerGroup::find( const QString &name )
+{
+    return name.isEmpty() ? global() : s_groups.value( name );
+}
+
+
+QStringList KTimerGroup::names()
+{
+    return s_groups.keys();
+}
+
+
+void KTimerGroup::loadAll( KConfig *cfg )
+{
+    const KConfigGroup groupscfg = cfg->group( "Groups" );
+    const QStringList list = groupscfg.readEntry( "Names", QStringList() );
+
+    for( int i=-1; i<list.count(); ++i ) {
+        KTimerGroup *group = i<0 ? global() : KTimerGroup::group( list.at( i ) );
+        const KConfigGroup groupcfg = i<0 ? groupscfg : cfg->group( QStringLiteral( "Group %1" ).arg( list.at( i ) ) );
+        group->loadSettings( groupcfg, true );
+    }
+}
+
+
+void KTimerGroup::reload( KConfig *cfg, const QStringList &removed )
+{
+    // A group missing from cfg reads as the defaults.
+    const QStringList list = cfg->groupList() + removed;
+    for( int i=0; i<list.count(); ++i ) {
+        if( list.at( i )==QLatin1String( "Groups" ) )
+            global()->loadSettings( cfg->group( list.at( i ) ), false );
+        else if( list.at( i ).startsWith( QLatin1String( "Group " ) ) )
+            group( list.at( i ).mid( 6 ) )->loadSettings( cfg->group( list.at( i ) ), false );
+    }
+}
+
+
+void KTimerGroup::loadSettings( const KConfigGroup &groupcfg, bool quietly )
+{
+    m_onPause = groupcfg.readPathEntry( "OnPause", QString() );
+    m_onResume = groupcfg.readPathEntry( "OnResume", QString() );
+    m_onStop = groupcfg.readPathEntry( "OnStop", QString() );
+
+    const bool paused = groupcfg.readEntry( "Paused", false );
+    if( paused==m_paused )
+        return;
+
+    if( !quietly ) {
+        if( paused )
+            pause();
+        else
+            resume();
+    } else if( paused ) {
+        // Stay paused, without running the hook again.
+        m_pausedAt = m_parent ? m_parent->time() : KTimerScheduler::self()->now();
+        m_paused = true;
+    }
+}
+
+
+void KTimerGroup::saveAll( KConfig *cfg )
+{
+    // Groups without settings of their own come back with their jobs.
+    QStringList list;
+    for( QMap<QString, KTimerGroup *>::const_iterator it = s_groups.constBegin(); it != s_groups.constEnd(); ++it ) {
+        const KTimerGroup *group = it.value();
+        if( group->m_paused || !group->m_onPause.isEmpty() || !group->m_onResume.isEmpty() || !group->m_onStop.isEmpty() )
+            list.append( it.key() );
+    }
+
+    KConfigGroup groupscfg = cfg->group( "Groups" );
+    groupscfg.writeEntry( "Names", list );
+
+    for( int i=-1; i<list.count(); ++i ) {
+        const KTimerGroup *group = i<0 ? global() : s_groups.value( list.at( i ) );
+        KConfigGroup groupcfg = i<0 ? groupscfg : cfg->group( QStringLiteral( "Group %1" ).arg( list.at( i ) ) );
+
+        groupcfg.writePathEntry( "OnPause", group->m_onPause );
+        groupcfg.writePathEntry( "OnResume", group->m_onResume );
+        groupcfg.writePathEntry( "OnStop", group->m_onStop );
+        groupcfg.writeEntry( "Paused", group->m_paused );
+    }
+}
+
+
+QString KTimerGroup::name() const
+{
+    return m_name;
+}
+
+
+bool KTimerGroup::isGlobal() const
+{
+    return !m_parent;
+}
+
+
+qint64 KTimerGroup::time() const
+{
+    if( m_paused )
+        return m_pausedAt - m_offset;
+
+    const qint64 base = m_parent ? m_parent->time() : KTimerScheduler::self()->now();
+    return base - m_offset;
+}
+
+
+bool KTimerGroup::isPaused() const
+{
+    return m_paused;
+}
+
+
+bool KTimerGroup::isRunning() const
+{
+    return !m_paused && ( !m_parent || m_parent->isRunning() );
+}
+
+
+quint64 KTimerGroup::generation() const
+{
+    return m_generation + ( m_parent ? m_parent->generation() : 0 );
+}
+
+
+QString KTimerGroup::onPause() const
+{
+    return m_onPause;
+}
+
+
+QString KTimerGroup::onResume() const
+{
+    return m_onResume;
+}
+
+
+QString KTimerGroup::onStop() const
+{
+    return m_onStop;
+}
+
+
+void KTimerGroup::setOnPause( const QString &cmd )
+{
+    m_onPause = cmd;
+}
+
+
+void KTimerGroup::setOnResume( const QString &cmd )
+{
+    m_onResume = cmd;
+}
+
+
+void KTimerGroup::setOnStop( const QString &cmd )
+{
+    m_onStop = cmd;
+}
+
+
+void KTimerGroup::pause()
+{
+    if( m_paused )
+        return;
+
+    m_pausedAt = m_parent ? m_parent->time() : KTimerScheduler::self()->now();
+    m_paused = true;
+    KTimerScheduler::self()->rearm();
+
+    fireHook( m_onPause );
+    emit stateChanged( this );
+}
+
+
+void KTimerGroup::resume()
+{
+    if( !m_paused )
+        return;
+
+    // The clock picks up where it stopped.
+    const qint64 base = m_parent ? m_parent->time() : KTimerScheduler::self()->now();
+    m_offset += base - m_pausedAt;
+    m_paused = false;
+    KTimerScheduler::self()->rearm();
+
+    fireHook( m_onResume );
+    emit stateChanged( this );
+}
+
+
+void KTimerGroup::stop()
+{
+    // Nothing is left to be frozen: let the clock run again, quietly.
+    if( m_paused ) {
+        const qint64 base = m_parent ? m_parent->time() : KTimerScheduler::self()->now();
+        m_offset += base - m_pausedAt;
+        m_paused = false;
+    }
+
+    ++m_generation;
+    KTimerScheduler::self()->clear( this );
+
+    fireHook( m_onStop );
+    emit stateChanged( this );
+}
+
+
+void KTimerGroup::fireHook( const QString &cmd )
+{
+    // Like KTimerJob::fireInferior(), only the leader runs hooks.
+    if( cmd.simplified().isEmpty() || KTimerScheduler::self()->isFollowing() )
+        return;
+
+    KTimerProcess *proc = new KTimerProcess( this );
+    connect(proc, &KTimerProcess::finished, proc, &QObject::deleteLater);
+    if( !proc->start( cmd ) )
+        delete proc;
+}
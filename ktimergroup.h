@@ -0,0 +1,104 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERGROUP_H_INCLUDED
+#define KTIMERGROUP_H_INCLUDED
+
+#include <QObject>
+#include <QStringList>
+
+class KConfig;
+class KConfigGroup;
+
+/**
+ * A named set of jobs sharing a time base.
+ *
+ * The deadlines of the jobs of a group are kept on the group's clock,
+ * time(), which stands still while the group is paused. Pausing or resuming
+ * a group therefore only moves its clock, however many jobs are in it; the
+ * jobs keep their own state. Named groups run on the clock of the global
+ * group, so pausing the global group freezes every job.
+ *
+ * Stopping a group drops its jobs from the scheduler and bumps the group's
+ * generation; each job notices it was stopped the next time it is looked at.
+ *
+ * The hooks of a group run once per pause, resume or stop of the group,
+ * not once per job, and only in the ktimer that runs the jobs (see KTimerLeader).
+ */
+class KTimerGroup : public QObject {
+ Q_OBJECT
+
+ public:
+    virtual ~KTimerGroup();
+
+    static KTimerGroup *global();
+    // The group of that name, created on first use; the empty name is the global group.
+    static KTimerGroup *group( const QString &name );
+    // Likewise, but 0 for a group nobody used yet.
+    static KTimerGroup *find( const QString &name );
+    static QStringList names();
+
+    static void loadAll( KConfig *cfg );
+    static void saveAll( KConfig *cfg );
+    // Applies the groups present in cfg, which need not hold all of them,
+    // and resets those whose config group was removed.
+    static void reload( KConfig *cfg, const QStringList &removed );
+
+    QString name() const;
+    bool isGlobal() const;
+
+    // Milliseconds on the group's clock, in the base of KTimerScheduler::now().
+    qint64 time() const;
+    bool isPaused() const;
+    // Neither this group nor the global group is paused.
+    bool isRunning() const;
+    // Changes whenever this group or the global group is stopped.
+    quint64 generation() const;
+
+    QString onPause() const;
+    QString onResume() const;
+    QString onStop() const;
+    void setOnPause( const QString &cmd );
+    void setOnResume( const QString &cmd );
+    void setOnStop( const QString &cmd );
+
+ public slots:
+    void pause();
+    void resume();
+    void stop();
+
+ signals:
+    void stateChanged( KTimerGroup *group );
+
+ private:
+    explicit KTimerGroup( const QString &name, KTimerGroup *parent );
+    void loadSettings( const KConfigGroup &groupcfg, bool quietly );
+    void fireHook( const QString &cmd );
+
+    QString m_name;
+    KTimerGroup *m_parent;
+    bool m_paused;
+    qint64 m_pausedAt;      // parent's time when paused
+    qint64 m_offset;        // time spent paused, msecs
+    quint64 m_generation;
+    QString m_onPause;
+    QString m_onResume;
+    QString m_onStop;
+};
+
+#endif
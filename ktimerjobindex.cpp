@@ -0,0 +1,190 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerjobindex.h"
+#include "ktimer.h"
+#include "ktimergroup.h"
+
+#include <algorithm>
+
+// The distinct trigrams of a case folded text, sorted.
+static QVector<quint64> trigrams( const QString &folded )
+{
+    QVector<quint64> keys;
+    if( folded.size()<3 )
+        return keys;
+
+    keys.reserve( folded.size()-2 );
+    for( int i=0; i+3<=folded.size(); ++i )
+        keys.append( ( quint64( folded.at( i ).unicode() )<<32 ) | ( quint64( folded.at( i+1 ).unicode() )<<16 ) | folded.at( i+2 ).unicode() );
+    std::sort( keys.begin(), keys.end() );
+    keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+    return keys;
+}
+
+
+KTimerJobIndex::KTimerJobIndex( QObject *parent )
+    : QObject( parent )
+{
+}
+
+
+KTimerJobIndex::~KTimerJobIndex()
+{
+}
+
+
+void KTimerJobIndex::add( KTimerJob *job )
+{
+    if( m_commands.contains( job ) )
+        return;
+
+    indexCommand( job, job->command().toCaseFolded() );
+    setGroup( job, job->group()->name() );
+}
+
+
+void KTimerJobIndex::update( KTimerJob *job )
+{
+    QHash<KTimerJob *, QString>::const_iterator it = m_commands.constFind( job );
+    if( it==m_commands.constEnd() )
+        return;
+
+    const QString folded = job->command().toCaseFolded();
+    if( folded!=it.value() ) {
+        unindexCommand( job );
+        indexCommand( job, folded );
+    }
+    if( job->group()->name()!=m_groupOf.value( job ) )
+        setGroup( job, job->group()->name() );
+}
+
+
+bool KTimerJobIndex::matches( KTimerJob *job, const Filter &filter ) const
+{
+    if( !filter.text.isEmpty() && !m_commands.value( job ).contains( filter.text.toCaseFolded() ) )
+        return false;
+    if( filter.state>=0 && job->state()!=filter.state )
+        return false;
+    if( !filter.group.isNull() && m_groupOf.value( job )!=filter.group )
+        return false;
+    return true;
+}
+
+
+QVector<KTimerJob *> KTimerJobIndex::find( const Filter &filter ) const
+{
+    // Pick the smallest set of candidates we can get at without a scan.
+    QVector<KTimerJob *> candidates;
+    const QVector<quint64> keys = trigrams( filter.text.toCaseFolded() );
+    if( !keys.isEmpty() ) {
+        const QVector<KTimerJob *> *rarest = 0;
+        for( int i=0; i<keys.count(); ++i ) {
+            QHash<quint64, QVector<KTimerJob *> >::const_iterator it = m_trigrams.constFind( keys.at( i ) );
+            if( it==m_trigrams.constEnd() )
+                return QVector<KTimerJob *>();
+            if( !rarest || it->count()<rarest->count() )
+                rarest = &it.value();
+        }
+        candidates = *rarest;
+    } else if( !filter.group.isNull() ) {
+        const QSet<KTimerJob *> jobs = m_groups.value( filter.group );
+        candidates.reserve( jobs.count() );
+        for( QSet<KTimerJob *>::const_iterator it = jobs.constBegin(); it != jobs.constEnd(); ++it )
+            candidates.append( *it );
+    } else if( filter.state>=0 ) {
+        const QList<KTimerJob *> jobs = KTimerJob::jobs( (KTimerJob::States)filter.state );
+        candidates.reserve( jobs.count() );
+        for( int i=0; i<jobs.count(); ++i ) {
+            if( m_commands.contains( jobs.at( i ) ) )
+                candidates.append( jobs.at( i ) );
+        }
+    } else {
+        candidates.reserve( m_commands.count() );
+        for( QHash<KTimerJob *, QString>::const_iterator it = m_commands.constBegin(); it != m_commands.constEnd(); ++it )
+            candidates.append( it.key() );
+    }
+
+    QVector<KTimerJob *> found;
+    for( int i=0; i<candidates.count(); ++i ) {
+        if( matches( candidates.at( i ), filter ) )
+            found.append( candidates.at( i ) );
+    }
+    return found;
+}
+
+
+void KTimerJobIndex::remove( KTimerJob *job )
+{
+    if( !m_commands.contains( job ) )
+        return;
+    unindexCommand( job );
+    m_commands.remove( job );
+
+    const QString group = m_groupOf.take( job );
+    QHash<QString, QSet<KTimerJob *> >::iterator it = m_groups.find( group );
+    if( it!=m_groups.end() ) {
+        it->remove( job );
+        if( it->isEmpty() )
+            m_groups.erase( it );
+    }
+}
+
+
+void KTimerJobIndex::setGroup( KTimerJob *job, const QString &name )
+{
+    QHash<KTimerJob *, QString>::iterator old = m_groupOf.find( job );
+    if( old!=m_groupOf.end() ) {
+        QHash<QString, QSet<KTimerJob *> >::iterator it = m_groups.find( old.value() );
+        if( it!=m_groups.end() ) {
+            it->remove( job );
+            if( it->isEmpty() )
+                m_groups.erase( it );
+        }
+    }
+    m_groupOf.insert( job, name );
+    m_groups[name].insert( job );
+}
+
+
+void KTimerJobIndex::indexCommand( KTimerJob *job, const QString &folded )
+{
+    m_commands.insert( job, folded );
+
+    const QVector<quint64> keys = trigrams( folded );
+    for( int i=0; i<keys.count(); ++i ) {
+        QVector<KTimerJob *> &jobs = m_trigrams[keys.at( i )];
+        jobs.insert( std::lower_bound( jobs.begin(), jobs.end(), job ), job );
+    }
+}
+
+
+void KTimerJobIndex::unindexCommand( KTimerJob *job )
+{
+    const QVector<quint64> keys = trigrams( m_commands.value( job ) );
+    for( int i=0; i<keys.count(); ++i ) {
+        QHash<quint64, QVector<KTimerJob *> >::iterator it = m_trigrams.find( keys.at( i ) );
+        if( it==m_trigrams.end() )
+            continue;
+        QVector<KTimerJob *>::iterator pos = std::lower_bound( it->begin(), it->end(), job );
+        if( pos!=it->end() && *pos==job )
+            it->erase( pos );
+        if( it->isEmpty() )
+            m_trigrams.erase( it );
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERJOBINDEX_H_INCLUDED
+#define KTIMERJOBINDEX_H_INCLUDED
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+class KTimerJob;
+
+/**
+ * Finds jobs by command text, state and group without looking at every job.
+ *
+ * Commands are indexed by their trigrams, each trigram keeping a sorted list
+ * of the jobs whose command contains it. A search only verifies the jobs of
+ * the rarest trigram of the text searched for, so it costs about as much as
+ * there are jobs to be found. Texts shorter than a trigram fall back to the
+ * jobs of the state or group searched for, or to all jobs.
+ *
+ * The index is told about the jobs as they come, change and go, see update().
+ */
+class KTimerJobIndex : public QObject {
+ Q_OBJECT
+
+ public:
+    struct Filter {
+        Filter() : state( -1 ) {}
+        bool isEmpty() const { return text.isEmpty() && state<0 && group.isNull(); }
+
+        QString text;       // part of the command, case insensitive
+        int state;          // a KTimerJob::States, -1 for any
+        QString group;      // exact group name, null for any
+    };
+
+    explicit KTimerJobIndex( QObject *parent=0 );
+    virtual ~KTimerJobIndex();
+
+    void add( KTimerJob *job );
+    // Takes in the current command and group of the job.
+    void update( KTimerJob *job );
+    void remove( KTimerJob *job );
+    bool matches( KTimerJob *job, const Filter &filter ) const;
+    QVector<KTimerJob *> find( const Filter &filter ) const;
+
+ private:
+    void setGroup( KTimerJob *job, const QString &name );
+    void indexCommand( KTimerJob *job, const QString &folded );
+    void unindexCommand( KTimerJob *job );
+
+    QHash<quint64, QVector<KTimerJob *> > m_trigrams;  // trigram -> jobs, sorted
+    QHash<KTimerJob *, QString> m_commands;             // case folded, as indexed
+    QHash<QString, QSet<KTimerJob *> > m_groups;        // group name -> jobs
+    QHash<KTimerJob *, QString> m_groupOf;
+};
+
+#endif
@@ -0,0 +1,438 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerjobstore.h"
+#include "ktimer.h"
+#include "ktimer_debug.h"
+#include "ktimerbatch.h"
+#include "ktimerconfigwatcher.h"
+#include "ktimereventlog.h"
+#include "ktimergroup.h"
+#include "ktimerleader.h"
+#include "ktimernotifier.h"
+#include "ktimerscheduler.h"
+#include "ktimersnapshot.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QList>
+#include <QStandardPaths>
+#include <QTimer>
+#include <KConfigGroup>
+#include <KSharedConfig>
+
+struct KTimerJobStorePrivate {
+    QList<KTimerJob *> jobs;
+    KTimerNotifier *notifier;
+    KTimerLeader *leader;           // 0 until share()d
+    KTimerConfigWatcher *watcher;   // likewise
+    QTimer *saveLater;              // lets followers see what the leader does
+    bool lost;                      // the snapshot could not be read, do not save over it
+    quint64 stamp;                  // of the snapshot the jobs were last read from or saved to
+
+    QHash<KTimerJob *, KTimerJob::Fields> changes;   // not yet reported
+    QTimer *flush;
+
+    KTimerEventLog log;             // written by the leader only
+};
+
+
+KTimerJobStore::KTimerJobStore( QObject *parent )
+    : QObject( parent )
+{
+    d = new KTimerJobStorePrivate;
+    d->notifier = new KTimerNotifier( this );
+    d->leader = 0;
+    d->watcher = 0;
+    d->lost = false;
+    d->stamp = 0;
+
+    d->saveLater = new QTimer( this );
+    d->saveLater->setSingleShot( true );
+    d->saveLater->setInterval( 1000 );
+    connect(d->saveLater, &QTimer::timeout, this, &KTimerJobStore::saveAll);
+
+    d->flush = new QTimer( this );
+    d->flush->setSingleShot( true );
+    d->flush->setInterval( 0 );
+    connect(d->flush, &QTimer::timeout, this, &KTimerJobStore::flushChanges);
+
+    watchGroup( KTimerGroup::global() );
+}
+
+
+KTimerJobStore::~KTimerJobStore()
+{
+    for( int i=0; i<d->jobs.count(); ++i ) {
+        d->jobs.at( i )->setStore( 0 );
+        delete d->jobs.at( i );
+    }
+    delete d;
+}
+
+
+int KTimerJobStore::count() const
+{
+    return d->jobs.count();
+}
+
+
+KTimerJob *KTimerJobStore::at( int index ) const
+{
+    return d->jobs.at( index );
+}
+
+
+int KTimerJobStore::indexOf( KTimerJob *job ) const
+{
+    return d->jobs.indexOf( job );
+}
+
+
+// A job reporting to the store; the caller appends it once it is set up.
+KTimerJob *KTimerJobStore::newJob()
+{
+    KTimerJob *job = new KTimerJob;
+    job->setStore( this );
+    return job;
+}
+
+
+KTimerJob *KTimerJobStore::add()
+{
+    KTimerJob *job = newJob();
+    d->jobs.append( job );
+    emit jobAdded( job );
+    return job;
+}
+
+
+void KTimerJobStore::remove( KTimerJob *job )
+{
+    if( !d->jobs.removeOne( job ) )
+        return;
+    d->changes.remove( job );
+    emit jobRemoved( job );
+    job->setStore( 0 );
+    delete job;
+    scheduleSave();
+}
+
+
+bool KTimerJobStore::share()
+{
+    if( d->leader )
+        return d->leader->isValid();
+
+    d->leader = new KTimerLeader( KTimerLeader::defaultDirectory(), this );
+    KTimerScheduler::self()->setFollowing( !d->leader->isLeader() );
+    connect(d->leader, &KTimerLeader::elected, this, &KTimerJobStore::leaderElected);
+    connect(d->leader, &KTimerLeader::followerJoined, this, &KTimerJobStore::saveAll);
+    return d->leader->isValid();
+}
+
+
+void KTimerJobStore::watch()
+{
+    if( d->watcher )
+        return;
+
+    const QString name = KSharedConfig::openConfig()->name();
+    d->watcher = new KTimerConfigWatcher( QFileInfo( name ).isAbsolute() ? name
+                                          : QStandardPaths::writableLocation( QStandardPaths::GenericConfigLocation ) + QLatin1Char( '/' ) + name, this );
+    connect(d->watcher, &KTimerConfigWatcher::changed, this, &KTimerJobStore::configChanged);
+}
+
+
+void KTimerJobStore::openEventLog()
+{
+    if( !isLeader() || d->log.isOpen() )
+        return;
+
+    const quint32 capacity = KSharedConfig::openConfig()->group( "Jobs" ).readEntry( "EventLogSize", 1u<<20 );
+    if( capacity && !d->log.open( KTimerEventLog::defaultPath(), capacity ) )
+        qCWarning(KTIMER_LOG) << "not logging the runs of the jobs";
+}
+
+
+bool KTimerJobStore::isLeader() const
+{
+    return !d->leader || d->leader->isLeader();
+}
+
+
+void KTimerJobStore::saveAll()
+{
+    if( isLeader() )
+        save( KSharedConfig::openConfig().data() );
+}
+
+
+void KTimerJobStore::scheduleSave()
+{
+    if( d->leader && d->leader->isLeader() && d->leader->hasFollowers() && !d->saveLater->isActive() )
+        d->saveLater->start();
+}
+
+
+// The leader went away; what it saved last is what we have.
+void KTimerJobStore::leaderElected( qint64 since )
+{
+    openEventLog();
+    KTimerScheduler::self()->takeOver( since );
+    emit elected();
+}
+
+
+// Followers only hear of a pause or resume of a group through the saved state.
+void KTimerJobStore::watchGroup( KTimerGroup *group )
+{
+    connect(group, &KTimerGroup::stateChanged, this, &KTimerJobStore::scheduleSave, Qt::UniqueConnection);
+}
+
+
+void KTimerJobStore::watchGroups()
+{
+    const QStringList names = KTimerGroup::names();
+    for( int i=0; i<names.count(); ++i )
+        watchGroup( KTimerGroup::group( names.at( i ) ) );
+}
+
+
+void KTimerJobStore::noteChanged( KTimerJob *job, KTimerJob::Fields fields )
+{
+    if( fields & KTimerJob::Group )
+        watchGroup( job->group() );
+    d->changes[job] |= fields;
+    if( !d->flush->isActive() )
+        d->flush->start();
+    if( fields & ~KTimerJob::Fields( KTimerJob::Usage ) )
+        scheduleSave();
+}
+
+
+void KTimerJobStore::flushChanges()
+{
+    QHash<KTimerJob *, KTimerJob::Fields> changes;
+    changes.swap( d->changes );
+    if( !changes.isEmpty() )
+        emit jobsChanged( changes );
+}
+
+
+void KTimerJobStore::noteFired( KTimerJob *job )
+{
+    const KTimerEvent event = { QDateTime::currentMSecsSinceEpoch(), job->id(), KTimerEvent::Fired, 0, 0 };
+    d->log.append( event );
+    d->notifier->jobFired( job );
+    emit jobFired( job );
+}
+
+
+// Starts the next job in the list if it is to follow this one.
+void KTimerJobStore::noteFinished( KTimerJob *job, bool error )
+{
+    const KTimerEvent event = { QDateTime::currentMSecsSinceEpoch(), job->id(),
+                                quint32( error ? KTimerEvent::Failed : KTimerEvent::Succeeded ), job->exitCode(), job->runtime() };
+    d->log.append( event );
+    d->notifier->jobFinished( job, error );
+    emit jobFinished( job, error );
+
+    const int i = d->jobs.indexOf( job );
+    if( i<0 || i+1>=d->jobs.count() || !d->jobs.at( i+1 )->consecutive() )
+        return;
+
+    KTimerJob *next = d->jobs.at( i+1 );
+    if( job->pipeOutput() )
+        next->setInput( job->takeOutput() );
+    next->start();
+}
+
+
+void KTimerJobStore::save( KConfig *cfg )
+{
+	if( d->lost )
+		return;
+
+	KConfigGroup jobscfg = cfg->group("Jobs");
+	const int nbList=d->jobs.count();
+	bool saved = false;
+
+	// The jobs go to the snapshot instead, so that the next start has nothing to parse.
+	if( jobscfg.readEntry( "Snapshot", false ) ) {
+		KTimerSnapshotWriter writer;
+		for (int num = 0; num < nbList; ++num)
+			d->jobs.at( num )->save( &writer );
+
+		const quint64 stamp = QDateTime::currentMSecsSinceEpoch();
+		if( writer.write( KTimerSnapshot::defaultPath(), stamp ) ) {
+			jobscfg.writeEntry( "SnapshotStamp", stamp );
+			d->stamp = stamp;
+			for (int num = 0; num < nbList; ++num)
+				cfg->deleteGroup( QStringLiteral( "Job%1" ).arg( num ) );
+			saved = true;
+		}
+	}
+
+	if( !saved ) {
+		for (int num = 0; num < nbList; ++num)
+			d->jobs.at( num )->save( cfg, QStringLiteral( "Job%1" ).arg( num ) );
+		jobscfg.deleteEntry( "SnapshotStamp" );
+	}
+
+    jobscfg.writeEntry( "Number", nbList );
+    jobscfg.writeEntry( "BatchWindow", KTimerBatch::window() );
+    jobscfg.writeEntry( "CatchUpRate", KTimerScheduler::self()->catchUpRate() );
+    jobscfg.writeEntry( "NotifyWindow", d->notifier->window() );
+    jobscfg.writeEntry( "PipeOutputLimit", KTimerJob::maxPipedOutput() );
+    KTimerGroup::saveAll( cfg );
+
+    jobscfg.sync();
+
+    // Not a change to pick up.
+    if( d->watcher && cfg==KSharedConfig::openConfig().data() )
+        d->watcher->sync();
+}
+
+
+void KTimerJobStore::loadSettings( const KConfigGroup &main )
+{
+	KTimerBatch::setWindow( main.readEntry( "BatchWindow", KTimerBatch::window() ) );
+	KTimerScheduler::self()->setCatchUpRate( main.readEntry( "CatchUpRate", KTimerScheduler::self()->catchUpRate() ) );
+	d->notifier->setWindow( main.readEntry( "NotifyWindow", d->notifier->window() ) );
+	KTimerJob::setMaxPipedOutput( main.readEntry( "PipeOutputLimit", KTimerJob::maxPipedOutput() ) );
+}
+
+
+void KTimerJobStore::load( KConfig *cfg )
+{
+	const KConfigGroup main=cfg->group("Jobs");
+
+	loadSettings( main );
+	KTimerGroup::loadAll( cfg );
+	watchGroups();
+
+    const int num = main.readEntry( "Number", 0 );
+
+    // The first jobs may come from the snapshot, those added since from the config file.
+    // Either way each job is built here: the snapshot spares the parse, not the jobs.
+    KTimerSnapshot snapshot;
+    int fromSnapshot = 0;
+    if( main.readEntry( "Snapshot", false ) && main.hasKey( "SnapshotStamp" ) ) {
+        if( snapshot.open( KTimerSnapshot::defaultPath(), main.readEntry( "SnapshotStamp", quint64( 0 ) ) ) ) {
+            fromSnapshot = qMin( snapshot.count(), num );
+            d->stamp = main.readEntry( "SnapshotStamp", quint64( 0 ) );
+        } else {
+            // Their groups went when the snapshot was written; blank jobs saved in
+            // their place would be all that is left of them.
+            qCWarning(KTIMER_LOG) << "the job snapshot" << KTimerSnapshot::defaultPath() << "is missing or damaged;"
+                                  << "not loading nor saving the jobs until ktimer starts with it restored, or with SnapshotStamp removed from" << cfg->name();
+            d->lost = true;
+            return;
+        }
+    }
+
+    d->jobs.reserve( d->jobs.count()+num );
+    for( int n=0; n<num; n++ ) {
+        KTimerJob *job = newJob();
+        if( n<fromSnapshot )
+            job->load( snapshot, n );
+        else
+            job->load( cfg, QStringLiteral( "Job%1" ).arg(n) );
+
+        d->jobs.append( job );
+        emit jobAdded( job );
+    }
+}
+
+
+// Applies what changed in the config file since we last read or wrote it.
+void KTimerJobStore::configChanged( KConfig *changes, const QStringList &removed )
+{
+    // Bring the shared config up to date with just the changes. It only
+    // learns what the file already says, so there is nothing to write back.
+    KSharedConfig::Ptr cfg = KSharedConfig::openConfig();
+    const bool dirty = cfg->isDirty();
+    const QStringList list = changes->groupList();
+    for( int i=0; i<list.count(); ++i ) {
+        KConfigGroup group = cfg->group( list.at( i ) );
+        group.deleteGroup();
+        changes->group( list.at( i ) ).copyTo( &group );
+    }
+    for( int i=0; i<removed.count(); ++i )
+        cfg->deleteGroup( removed.at( i ) );
+    if( !dirty )
+        cfg->markAsClean();
+
+    KTimerGroup::reload( changes, removed );
+    watchGroups();
+
+    const int oldCount = d->jobs.count();
+    if( changes->hasGroup( "Jobs" ) ) {
+        const KConfigGroup main = changes->group( "Jobs" );
+        loadSettings( main );
+
+        const int num = main.readEntry( "Number", 0 );
+        while( d->jobs.count()>num )
+            remove( d->jobs.last() );
+
+        // A new stamp means the leader saved the jobs to a new snapshot, not to their groups.
+        KTimerSnapshot snapshot;
+        int fromSnapshot = 0;
+        const quint64 stamp = main.readEntry( "SnapshotStamp", quint64( 0 ) );
+        if( main.readEntry( "Snapshot", false ) && main.hasKey( "SnapshotStamp" ) && stamp!=d->stamp ) {
+            if( snapshot.open( KTimerSnapshot::defaultPath(), stamp ) ) {
+                fromSnapshot = qMin( snapshot.count(), num );
+                d->stamp = stamp;
+            } else {
+                qCWarning(KTIMER_LOG) << "cannot follow the job snapshot" << KTimerSnapshot::defaultPath();
+            }
+        }
+
+        for( int n=0; n<qMin( fromSnapshot, d->jobs.count() ); n++ ) {
+            KTimerJob *job = d->jobs.at( n );
+            job->reload( snapshot, n );
+            emit jobReloaded( job );
+        }
+
+        // A new job may reuse a group left over in the file, which only the shared config has.
+        for( int n=d->jobs.count(); n<num; n++ ) {
+            KTimerJob *job = newJob();
+            if( n<fromSnapshot )
+                job->load( snapshot, n );
+            else
+                job->load( cfg.data(), QStringLiteral( "Job%1" ).arg(n) );
+            d->jobs.append( job );
+            emit jobAdded( job );
+        }
+    }
+
+    const int count = qMin( oldCount, d->jobs.count() );
+    for( int i=0; i<list.count(); ++i ) {
+        if( !list.at( i ).startsWith( QLatin1String( "Job" ) ) )
+            continue;
+        bool ok;
+        const int n = list.at( i ).mid( 3 ).toInt( &ok );
+        if( !ok || n<0 || n>=count )
+            continue;
+
+        KTimerJob *job = d->jobs.at( n );
+        job->reload( changes, list.at( i ) );
+        emit jobReloaded( job );
+    }
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERJOBSTORE_H_INCLUDED
+#define KTIMERJOBSTORE_H_INCLUDED
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+
+#include "ktimer.h"
+
+class KConfig;
+class KConfigGroup;
+class KTimerGroup;
+
+/**
+ * The jobs, in the order of the list, and all that keeps them going without a window.
+ *
+ * The store loads and saves the jobs, follows edits of the config file,
+ * takes part in the election of the ktimer that runs them, posts the
+ * notifications, logs the runs (see KTimerEventLog) and starts
+ * consecutive jobs. KTimerPref is only a view of
+ * it, built the first time it is opened.
+ *
+ * Its jobs report to the store directly rather than through connections of
+ * their own, and the store collects the changes of all jobs until the event
+ * loop comes round; so whoever is interested connects once, to the store.
+ */
+class KTimerJobStore : public QObject {
+ Q_OBJECT
+
+ public:
+    explicit KTimerJobStore( QObject *parent=0 );
+    virtual ~KTimerJobStore();
+
+    int count() const;
+    KTimerJob *at( int index ) const;
+    int indexOf( KTimerJob *job ) const;
+
+    // A new job at the end of the list.
+    KTimerJob *add();
+    void remove( KTimerJob *job );
+
+    // Joins the ktimers sharing the state directory (see KTimerLeader);
+    // before load(), so that a follower does not run the hooks of the jobs
+    // it restores. Until then, or without it, we lead. False if the
+    // directory cannot be shared, and nobody should run the jobs.
+    bool share();
+    bool isLeader() const;
+    // Follows edits of the config file.
+    void watch();
+    // Logs the runs of the jobs from now on, while we lead; see KTimerEventLog.
+    void openEventLog();
+
+    // Builds every job, also those read from a job snapshot. With an unusable
+    // snapshot nothing is loaded, and nothing saved from then on.
+    void load( KConfig *cfg );
+    void save( KConfig *cfg );
+
+ public slots:
+    // To the shared config; followers only ever read the jobs.
+    void saveAll();
+
+ signals:
+    // What changed about which jobs since the last time, each job once.
+    void jobsChanged( const QHash<KTimerJob *, KTimerJob::Fields> &changes );
+    void jobFired( KTimerJob *job );
+    void jobFinished( KTimerJob *job, bool error );
+
+    void jobAdded( KTimerJob *job );
+    // Just before the job is deleted.
+    void jobRemoved( KTimerJob *job );
+    // Settings of the job were read again from the config file.
+    void jobReloaded( KTimerJob *job );
+    // This ktimer now runs the jobs.
+    void elected();
+
+ private slots:
+    void configChanged( KConfig *changes, const QStringList &removed );
+    void leaderElected( qint64 since );
+    void flushChanges();
+    void scheduleSave();
+
+ private:
+    // Called by the jobs, see KTimerJob::notifyChanged().
+    friend class KTimerJob;
+    void noteChanged( KTimerJob *job, KTimerJob::Fields fields );
+    void noteFired( KTimerJob *job );
+    void noteFinished( KTimerJob *job, bool error );
+
+    KTimerJob *newJob();
+    void watchGroup( KTimerGroup *group );
+    void watchGroups();
+    void loadSettings( const KConfigGroup &main );
+
+    struct KTimerJobStorePrivate *d;
+};
+
+#endif
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerleader.h"
+#include "ktimer_debug.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#endif
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <QTimer>
+
+static QString s_defaultDirectory;
+
+
+// O_CLOEXEC matters: a command we start must not keep the lock once we are gone.
+static int openLockFile( const QString &path )
+{
+    const int fd = ::open( QFile::encodeName( path ).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600 );
+    if( fd<0 )
+        qCWarning(KTIMER_LOG) << "cannot open" << path;
+    return fd;
+}
+
+
+KTimerLeader::KTimerLeader( const QString &directory, QObject *parent )
+    : QObject( parent )
+{
+    QDir().mkpath( directory );
+    const QString lockPath = directory + QStringLiteral( "/ktimer.lock" );
+    const QString followersPath = directory + QStringLiteral( "/ktimer.followers" );
+    m_lock = openLockFile( lockPath );
+    m_followers = openLockFile( followersPath );
+    m_inotify = -1;
+    m_notifier = 0;
+    m_leader = false;
+    m_hasFollowers = false;
+
+    m_timer = new QTimer( this );
+    m_timer->setInterval( 5000 );
+    connect(m_timer, &QTimer::timeout, this, &KTimerLeader::poll);
+
+    // Another ktimer may well be running the jobs: better none of us than two.
+    if( !isValid() )
+        return;
+
+#ifdef Q_OS_LINUX
+    // The leader closing the lock file, and followers touching theirs.
+    m_inotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( m_inotify>=0 && ( inotify_add_watch( m_inotify, QFile::encodeName( lockPath ).constData(), IN_CLOSE_WRITE )<0
+                          || inotify_add_watch( m_inotify, QFile::encodeName( followersPath ).constData(), IN_ATTRIB )<0 ) ) {
+        ::close( m_inotify );
+        m_inotify = -1;
+    }
+    if( m_inotify>=0 ) {
+        m_notifier = new QSocketNotifier( m_inotify, QSocketNotifier::Read, this );
+        connect(m_notifier, &QSocketNotifier::activated, this, &KTimerLeader::readEvents);
+    }
+#endif
+
+    if( tryLead() ) {
+        checkFollowers();
+    } else {
+        ::flock( m_followers, LOCK_SH );
+        // Tells the leader, see checkFollowers().
+        ::futimens( m_followers, 0 );
+        m_timer->start();
+    }
+}
+
+
+KTimerLeader::~KTimerLeader()
+{
+    delete m_notifier;
+    if( m_inotify>=0 )
+        ::close( m_inotify );
+    if( m_lock>=0 )
+        ::close( m_lock );
+    if( m_followers>=0 )
+        ::close( m_followers );
+}
+
+
+QString KTimerLeader::defaultDirectory()
+{
+    if( !s_defaultDirectory.isEmpty() )
+        return s_defaultDirectory;
+    return QStandardPaths::writableLocation( QStandardPaths::AppDataLocation );
+}
+
+
+void KTimerLeader::setDefaultDirectory( const QString &directory )
+{
+    s_defaultDirectory = directory;
+}
+
+
+bool KTimerLeader::isValid() const
+{
+    return m_lock>=0 && m_followers>=0;
+}
+
+
+bool KTimerLeader::isLeader() const
+{
+    return m_leader;
+}
+
+
+bool KTimerLeader::hasFollowers() const
+{
+    return m_hasFollowers;
+}
+
+
+int KTimerLeader::interval() const
+{
+    return m_timer->interval();
+}
+
+
+void KTimerLeader::poll()
+{
+    if( m_leader ) {
+        checkFollowers();
+        return;
+    }
+
+    const qint64 since = heartbeat();
+    if( tryLead() ) {
+        ::flock( m_followers, LOCK_UN );
+        m_timer->stop();
+        qCDebug(KTIMER_LOG) << "took over running the jobs";
+        emit elected( since );
+        checkFollowers();
+    }
+}
+
+
+void KTimerLeader::readEvents()
+{
+#ifdef Q_OS_LINUX
+    // Which file does not matter, every event means: look again.
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while( ::read( m_inotify, buffer, sizeof( buffer ) )>0 )
+        ;
+#endif
+    poll();
+}
+
+
+// Heartbeats while followed, sleeps otherwise.
+void KTimerLeader::checkFollowers()
+{
+    // Nobody holds a shared lock if we can get an exclusive one.
+    const bool followed = ::flock( m_followers, LOCK_EX | LOCK_NB )<0;
+    if( !followed )
+        ::flock( m_followers, LOCK_UN );
+
+    if( followed ) {
+        ::futimens( m_lock, 0 );
+        if( !m_timer->isActive() )
+            m_timer->start();
+    } else if( m_inotify>=0 ) {
+        m_timer->stop();
+    } else if( !m_timer->isActive() ) {
+        // Nobody would tell us about a new follower: look for one every lease.
+        m_timer->start();
+    }
+
+    if( followed && !m_hasFollowers ) {
+        m_hasFollowers = true;
+        emit followerJoined();
+    }
+    m_hasFollowers = followed;
+}
+
+
+bool KTimerLeader::tryLead()
+{
+    if( ::flock( m_lock, LOCK_EX | LOCK_NB )<0 )
+        return false;
+
+    m_leader = true;
+    const QByteArray pid = QByteArray::number( qint64( ::getpid() ) ) + '\n';
+    if( ::ftruncate( m_lock, 0 )<0 || ::pwrite( m_lock, pid.constData(), pid.size(), 0 )<0 )
+        qCWarning(KTIMER_LOG) << "cannot write the lock file";
+    return true;
+}
+
+
+qint64 KTimerLeader::heartbeat() const
+{
+    struct stat st;
+    if( ::fstat( m_lock, &st )<0 )
+        return 0;
+    return qint64( st.st_mtim.tv_sec )*1000 + st.st_mtim.tv_nsec/1000000;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERLEADER_H_INCLUDED
+#define KTIMERLEADER_H_INCLUDED
+
+#include <QObject>
+#include <QString>
+
+class QSocketNotifier;
+class QTimer;
+
+/**
+ * Elects the one ktimer, among those sharing a state directory, that runs the jobs.
+ *
+ * The leader holds an exclusive flock() on "ktimer.lock" for as long as it
+ * lives; the kernel drops it when the process goes away, however it does.
+ * The others hold a shared lock on "ktimer.followers", so the leader can
+ * tell it is being followed, and retry the leader's lock every interval(),
+ * the lease: one of them takes over at most that long after the leader is
+ * gone. Where inotify is available they also retry as soon as the leader
+ * closes the lock file, usually well within the lease.
+ *
+ * While it is followed, the leader touches the lock file once a lease as a
+ * heartbeat, so the next leader knows since when runs may have gone
+ * missing. An unfollowed leader does not wake up at all: a follower joining
+ * touches "ktimer.followers", which the leader watches with inotify.
+ *
+ * If the lock files cannot be used, nobody is elected: isValid() is false.
+ */
+class KTimerLeader : public QObject {
+ Q_OBJECT
+
+ public:
+    explicit KTimerLeader( const QString &directory, QObject *parent=0 );
+    virtual ~KTimerLeader();
+
+    // The state directory used unless one was given on the command line.
+    static QString defaultDirectory();
+    static void setDefaultDirectory( const QString &directory );
+
+    bool isValid() const;
+    bool isLeader() const;
+    bool hasFollowers() const;
+    // The lease, msecs.
+    int interval() const;
+
+ signals:
+    // 'since' is the last heartbeat of the previous leader, msecs since the epoch.
+    void elected( qint64 since );
+    void followerJoined();
+
+ private slots:
+    void poll();
+    void readEvents();
+
+ private:
+    bool tryLead();
+    void checkFollowers();
+    qint64 heartbeat() const;
+
+    int m_lock;             // exclusive while leading
+    int m_followers;        // shared while following
+    int m_inotify;
+    QSocketNotifier *m_notifier;
+    bool m_leader;
+    bool m_hasFollowers;
+    QTimer *m_timer;        // followers: retry; a followed leader: heartbeat
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimernotifier.h"
+#include "ktimer.h"
+
+#include <QTimer>
+#include <KLocalizedString>
+#include <KNotification>
+
+static const char *const s_events[] = { "fired", "succeeded", "failed" };
+
+
+KTimerNotifier::KTimerNotifier( QObject *parent )
+    : QObject( parent )
+{
+    m_window = 10000;
+    for( int i=0; i<KindCount; ++i ) {
+        m_pending[i].timer = new QTimer( this );
+        m_pending[i].timer->setSingleShot( true );
+        m_pending[i].timer->setInterval( m_window );
+        m_pending[i].count = 0;
+        connect(m_pending[i].timer, &QTimer::timeout, this, &KTimerNotifier::windowEnded);
+    }
+}
+
+
+KTimerNotifier::~KTimerNotifier()
+{
+}
+
+
+int KTimerNotifier::window() const
+{
+    return m_window;
+}
+
+
+void KTimerNotifier::setWindow( int msec )
+{
+    m_window = qMax( msec, 0 );
+    for( int i=0; i<KindCount; ++i )
+        m_pending[i].timer->setInterval( m_window );
+}
+
+
+void KTimerNotifier::jobFired( KTimerJob *job )
+{
+    post( Fired, job );
+}
+
+
+void KTimerNotifier::jobFinished( KTimerJob *job, bool error )
+{
+    post( error ? Failed : Succeeded, job );
+}
+
+
+void KTimerNotifier::post( Kind kind, KTimerJob *job )
+{
+    Pending &pending = m_pending[kind];
+    if( pending.timer->isActive() ) {
+        ++pending.count;
+        pending.command = job->command();
+        return;
+    }
+
+    notify( kind, 1, job->command() );
+    pending.timer->start();
+}
+
+
+void KTimerNotifier::windowEnded()
+{
+    for( int i=0; i<KindCount; ++i ) {
+        Pending &pending = m_pending[i];
+        if( pending.timer!=sender() || pending.count==0 )
+            continue;
+
+        // Keep the window open, the burst may not be over yet.
+        notify( Kind( i ), pending.count, pending.command );
+        pending.count = 0;
+        pending.command.clear();
+        pending.timer->start();
+    }
+}
+
+
+void KTimerNotifier::notify( Kind kind, int count, const QString &command )
+{
+    QString text;
+    if( count==1 ) {
+        switch( kind ) {
+        case Fired: text = i18n( "Started %1.", command ); break;
+        case Succeeded: text = i18n( "%1 finished.", command ); break;
+        default: text = i18n( "%1 failed.", command ); break;
+        }
+    } else {
+        const int seconds = qMax( ( m_window+999 )/1000, 1 );
+        const QString last = i18np( "the last second", "the last %1 seconds", seconds );
+        switch( kind ) {
+        case Fired: text = i18np( "One job started in %2.", "%1 jobs started in %2.", count, last ); break;
+        case Succeeded: text = i18np( "One job finished in %2.", "%1 jobs finished in %2.", count, last ); break;
+        default: text = i18np( "One job failed in %2.", "%1 jobs failed in %2.", count, last ); break;
+        }
+    }
+
+    KNotification::event( QString::fromLatin1( s_events[kind] ), text, QPixmap(), 0, KNotification::CloseOnTimeout );
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERNOTIFIER_H_INCLUDED
+#define KTIMERNOTIFIER_H_INCLUDED
+
+#include <QObject>
+#include <QString>
+
+class QTimer;
+class KTimerJob;
+
+/**
+ * Desktop notifications for jobs that fired, succeeded or failed.
+ *
+ * The first event of a kind is shown right away. Further events of the
+ * same kind within the window are only counted, and shown as one summary
+ * when the window ends, so a burst of expiries costs one notification per
+ * kind and window rather than one per job. Counting an event does not
+ * touch the notification daemon at all.
+ */
+class KTimerNotifier : public QObject {
+ Q_OBJECT
+
+ public:
+    explicit KTimerNotifier( QObject *parent=0 );
+    virtual ~KTimerNotifier();
+
+    // Milliseconds.
+    int window() const;
+    void setWindow( int msec );
+
+ public slots:
+    void jobFired( KTimerJob *job );
+    void jobFinished( KTimerJob *job, bool error );
+
+ private slots:
+    void windowEnded();
+
+ private:
+    enum Kind { Fired, Succeeded, Failed, KindCount };
+
+    void post( Kind kind, KTimerJob *job );
+    void notify( Kind kind, int count, const QString &command );
+
+    struct Pending {
+        QTimer *timer;      // runs while the window of the last notification is open
+        int count;          // events held back since
+        QString command;    // of the last of them
+    };
+    Pending m_pending[KindCount];
+    int m_window;
+};
+
+#endif
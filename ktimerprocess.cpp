@@ -0,0 +1,639 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerprocess.h"
+#include "ktimerringbuffer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+#include <QFile>
+#include <QList>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTimer>
+#include <QVarLengthArray>
+#include <KShell>
+
+static KTimerLauncher *s_launcher = 0;
+
+static void closeFd( int *fd )
+{
+    if( *fd>=0 ) {
+        ::close( *fd );
+        *fd = -1;
+    }
+}
+
+// NB: may be called from a slot connected to the notifier itself.
+static void dropNotifier( QSocketNotifier **notifier )
+{
+    if( *notifier ) {
+        (*notifier)->setEnabled( false );
+        (*notifier)->deleteLater();
+        *notifier = 0;
+    }
+}
+
+static void setNonBlocking( int fd )
+{
+    ::fcntl( fd, F_SETFL, ::fcntl( fd, F_GETFL ) | O_NONBLOCK );
+}
+
+// Runs in the child between fork() and exec(). Failures are ignored: without
+// the privileges to raise its priority the command just runs as it would have.
+static void applyPriority( int increment, KTimerProcess::SchedulingClass scheduling )
+{
+    errno = 0;
+    int level = ::nice( increment );
+    if( level==-1 && errno!=0 )
+        level = ::getpriority( PRIO_PROCESS, 0 );
+
+#ifdef Q_OS_LINUX
+    if( scheduling!=KTimerProcess::NormalScheduling ) {
+        struct sched_param param;
+        param.sched_priority = 0;
+        ::sched_setscheduler( 0, scheduling==KTimerProcess::IdleScheduling ? SCHED_IDLE : SCHED_BATCH, &param );
+    }
+
+#ifdef SYS_ioprio_set
+    // ioprio_set(2) has no libc wrapper; best-effort level from the nice level
+    // like the kernel would do, or the idle class.
+    const int ioprioWhoProcess = 1;
+    const int ioprioClass = scheduling==KTimerProcess::IdleScheduling ? 3 : 2;
+    const int ioprioLevel = qBound( 0, ( level+20 ) / 5, 7 );
+    ::syscall( SYS_ioprio_set, ioprioWhoProcess, 0, ( ioprioClass<<13 ) | ioprioLevel );
+#endif
+#else
+    Q_UNUSED( scheduling );
+    Q_UNUSED( level );
+#endif
+}
+
+
+KTimerProcess::KTimerProcess( QObject *parent )
+    : QObject( parent )
+{
+    // Like QProcess: writing to a child that went away must not kill us.
+    static bool s_sigpipeIgnored = false;
+    if( !s_sigpipeIgnored ) {
+        ::signal( SIGPIPE, SIG_IGN );
+        s_sigpipeIgnored = true;
+    }
+
+    m_pid = 0;
+    m_inFd = -1;
+    m_outFd = -1;
+    m_inPiped = false;
+    m_outPiped = false;
+    m_detached = false;
+    m_launched = false;
+    m_outRing = 0;
+    m_errRing = 0;
+    m_stdin = -1;
+    m_stdout = -1;
+    m_stderr = -1;
+    m_pidfd = -1;
+    m_closeWrite = false;
+    m_stdinNotifier = 0;
+    m_stdoutNotifier = 0;
+    m_stderrNotifier = 0;
+    m_exitNotifier = 0;
+    m_exitPoll = 0;
+    m_usage = KTimerUsage();
+    m_niceIncrement = 0;
+    m_scheduling = NormalScheduling;
+    m_maxRuntime = 0;
+    m_timedOut = false;
+    m_watchdog = 0;
+}
+
+
+KTimerProcess::~KTimerProcess()
+{
+    if( m_pid>0 ) {
+        ::kill( (pid_t)m_pid, SIGKILL );
+        while( ::waitpid( (pid_t)m_pid, 0, 0 )<0 && errno==EINTR )
+            ;
+    }
+
+    teardown();
+}
+
+
+void KTimerProcess::setStandardInputFd( int fd )
+{
+    m_inFd = fd;
+    m_inPiped = false;
+}
+
+
+void KTimerProcess::setStandardInputPiped()
+{
+    m_inFd = -1;
+    m_inPiped = true;
+}
+
+
+void KTimerProcess::setStandardOutputFd( int fd )
+{
+    m_outFd = fd;
+    m_outPiped = false;
+    m_outRing = 0;
+}
+
+
+void KTimerProcess::setStandardOutputPiped()
+{
+    m_outFd = -1;
+    m_outPiped = true;
+    m_outRing = 0;
+}
+
+
+void KTimerProcess::setStandardOutputCapture( KTimerRingBuffer *ring )
+{
+    m_outFd = -1;
+    m_outPiped = true;
+    m_outRing = ring;
+}
+
+
+void KTimerProcess::setStandardErrorCapture( KTimerRingBuffer *ring )
+{
+    m_errRing = ring;
+}
+
+
+void KTimerProcess::setPriority( int niceIncrement, SchedulingClass scheduling )
+{
+    m_niceIncrement = niceIncrement;
+    m_scheduling = scheduling;
+}
+
+
+void KTimerProcess::setMaxRuntime( int msec )
+{
+    m_maxRuntime = msec;
+}
+
+
+bool KTimerProcess::timedOut() const
+{
+    return m_timedOut;
+}
+
+
+bool KTimerProcess::succeeded( QProcess::ExitStatus status ) const
+{
+    return status==QProcess::NormalExit && !m_timedOut;
+}
+
+
+void KTimerProcess::detach()
+{
+    m_outRing = 0;
+    m_errRing = 0;
+    m_detached = true;
+
+    if( isRunning() )
+        connect(this, &KTimerProcess::finished, this, &QObject::deleteLater);
+    else
+        deleteLater();
+}
+
+
+void KTimerProcess::setLauncher( KTimerLauncher *launcher )
+{
+    s_launcher = launcher;
+}
+
+
+void KTimerProcess::setFinished( int exitCode, QProcess::ExitStatus status, const KTimerUsage &usage )
+{
+    if( !m_launched )
+        return;
+
+    m_launched = false;
+    m_usage = usage;
+    emit finished( exitCode, status );
+}
+
+
+bool KTimerProcess::start( const QString &command )
+{
+    if( isRunning() )
+        return false;
+
+    if( s_launcher ) {
+        m_timedOut = false;
+        m_usage = KTimerUsage();
+        m_launched = s_launcher->launch( this, command );
+        return m_launched;
+    }
+
+    KShell::Errors splitError;
+    const QStringList args = KShell::splitArgs( command, KShell::TildeExpand, &splitError );
+    if( splitError!=KShell::NoError || args.isEmpty() )
+        return false;
+
+    const QString program = args.first().contains( QLatin1Char( '/' ) )
+        ? args.first() : QStandardPaths::findExecutable( args.first() );
+    if( program.isEmpty() )
+        return false;
+
+    // Everything the child needs is prepared up front: after fork() it may
+    // only make async-signal-safe calls.
+    const QByteArray path = QFile::encodeName( program );
+    QList<QByteArray> encoded;
+    for( int i=0; i<args.count(); ++i )
+        encoded.append( QFile::encodeName( args.at( i ) ) );
+    QVarLengthArray<char *, 16> argv;
+    for( int i=0; i<encoded.count(); ++i )
+        argv.append( const_cast<char *>( encoded.at( i ).constData() ) );
+    argv.append( 0 );
+
+    int in[2] = { -1, -1 };
+    int out[2] = { -1, -1 };
+    int err[2] = { -1, -1 };
+    int status[2] = { -1, -1 };
+    int devnull = -1;
+
+    bool ok = ::pipe2( status, O_CLOEXEC )==0;
+    if( ok && m_inPiped )
+        ok = ::pipe2( in, O_CLOEXEC )==0;
+    else if( ok && m_inFd<0 )
+        ok = ( devnull = ::open( "/dev/null", O_RDONLY | O_CLOEXEC ) )>=0;
+    if( ok && m_outPiped )
+        ok = ::pipe2( out, O_CLOEXEC )==0;
+    if( ok && m_errRing )
+        ok = ::pipe2( err, O_CLOEXEC )==0;
+
+    const int childIn = m_inPiped ? in[0] : ( m_inFd>=0 ? m_inFd : devnull );
+    const int childOut = m_outPiped ? out[1] : m_outFd;
+    const int childErr = err[1];
+
+    const pid_t pid = ok ? ::fork() : -1;
+    if( pid==0 ) {
+        ::setpgid( 0, 0 );
+        ::signal( SIGPIPE, SIG_DFL );
+        if( m_niceIncrement!=0 || m_scheduling!=NormalScheduling )
+            applyPriority( m_niceIncrement, m_scheduling );
+
+        ::dup2( childIn, STDIN_FILENO );
+        if( childOut>=0 )
+            ::dup2( childOut, STDOUT_FILENO );
+        if( childErr>=0 )
+            ::dup2( childErr, STDERR_FILENO );
+
+        ::execv( path.constData(), argv.data() );
+
+        const int error = errno;
+        if( ::write( status[1], &error, sizeof( error ) ) ) {}
+        ::_exit( 127 );
+    }
+
+    // Also from here, in case we get to signal the group before the child set it up.
+    if( pid>0 )
+        ::setpgid( pid, pid );
+
+    closeFd( &in[0] );
+    closeFd( &out[1] );
+    closeFd( &err[1] );
+    closeFd( &status[1] );
+    closeFd( &devnull );
+
+    // A successful exec() closes the status pipe, otherwise it carries errno.
+    bool execFailed = false;
+    if( pid>0 ) {
+        int error;
+        ssize_t n;
+        do {
+            n = ::read( status[0], &error, sizeof( error ) );
+        } while( n<0 && errno==EINTR );
+
+        execFailed = n==(ssize_t)sizeof( error );
+        if( execFailed ) {
+            while( ::waitpid( pid, 0, 0 )<0 && errno==EINTR )
+                ;
+        }
+    }
+    closeFd( &status[0] );
+
+    if( pid<=0 || execFailed ) {
+        closeFd( &in[1] );
+        closeFd( &out[0] );
+        closeFd( &err[0] );
+        return false;
+    }
+
+    m_pid = pid;
+    m_readBuffer.clear();
+    m_usage = KTimerUsage();
+    m_clock.start();
+
+    m_timedOut = false;
+    if( m_maxRuntime>0 ) {
+        if( !m_watchdog ) {
+            m_watchdog = new QTimer( this );
+            m_watchdog->setSingleShot( true );
+            connect(m_watchdog, &QTimer::timeout, this, &KTimerProcess::watchdog);
+        }
+        m_watchdog->start( m_maxRuntime );
+    }
+
+    if( m_inPiped ) {
+        m_stdin = in[1];
+        setNonBlocking( m_stdin );
+        m_stdinNotifier = new QSocketNotifier( m_stdin, QSocketNotifier::Write, this );
+        m_stdinNotifier->setEnabled( false );
+        connect(m_stdinNotifier, &QSocketNotifier::activated, this, &KTimerProcess::flushInput);
+        flushInput();
+    }
+
+    if( m_outPiped ) {
+        m_stdout = out[0];
+        setNonBlocking( m_stdout );
+        m_stdoutNotifier = new QSocketNotifier( m_stdout, QSocketNotifier::Read, this );
+        connect(m_stdoutNotifier, &QSocketNotifier::activated, this, &KTimerProcess::readOutput);
+    }
+
+    if( m_errRing ) {
+        m_stderr = err[0];
+        setNonBlocking( m_stderr );
+        m_stderrNotifier = new QSocketNotifier( m_stderr, QSocketNotifier::Read, this );
+        connect(m_stderrNotifier, &QSocketNotifier::activated, this, &KTimerProcess::readErrors);
+    }
+
+#if defined(Q_OS_LINUX) && defined(SYS_pidfd_open)
+    m_pidfd = (int)::syscall( SYS_pidfd_open, pid, 0 );
+#endif
+    if( m_pidfd>=0 ) {
+        m_exitNotifier = new QSocketNotifier( m_pidfd, QSocketNotifier::Read, this );
+        connect(m_exitNotifier, &QSocketNotifier::activated, this, &KTimerProcess::reap);
+    } else {
+        // No pidfd (old kernel), look for the exit now and then.
+        if( !m_exitPoll ) {
+            m_exitPoll = new QTimer( this );
+            connect(m_exitPoll, &QTimer::timeout, this, &KTimerProcess::reap);
+        }
+        m_exitPoll->start( 250 );
+    }
+
+    return true;
+}
+
+
+bool KTimerProcess::isRunning() const
+{
+    return m_pid>0 || m_launched;
+}
+
+
+qint64 KTimerProcess::processId() const
+{
+    return m_pid;
+}
+
+
+KTimerUsage KTimerProcess::usage() const
+{
+    return m_usage;
+}
+
+
+void KTimerProcess::terminate()
+{
+    if( m_pid>0 )
+        ::kill( (pid_t)m_pid, SIGTERM );
+}
+
+
+void KTimerProcess::kill()
+{
+    if( m_pid>0 )
+        ::kill( (pid_t)m_pid, SIGKILL );
+}
+
+
+void KTimerProcess::write( const QByteArray &data )
+{
+    if( !m_inPiped || m_closeWrite )
+        return;
+
+    m_writeBuffer.append( data );
+    flushInput();
+}
+
+
+void KTimerProcess::closeWriteChannel()
+{
+    m_closeWrite = true;
+    flushInput();
+}
+
+
+bool KTimerProcess::canReadLine() const
+{
+    return m_readBuffer.contains( '\n' );
+}
+
+
+QByteArray KTimerProcess::readLine()
+{
+    const int eol = m_readBuffer.indexOf( '\n' );
+    const QByteArray line = m_readBuffer.left( eol<0 ? m_readBuffer.size() : eol+1 );
+    m_readBuffer.remove( 0, line.size() );
+    return line;
+}
+
+
+QByteArray KTimerProcess::readAll()
+{
+    QByteArray data;
+    data.swap( m_readBuffer );
+    return data;
+}
+
+
+void KTimerProcess::flushInput()
+{
+    while( m_stdin>=0 && !m_writeBuffer.isEmpty() ) {
+        const ssize_t n = ::write( m_stdin, m_writeBuffer.constData(), m_writeBuffer.size() );
+        if( n>0 ) {
+            m_writeBuffer.remove( 0, n );
+        } else if( n<0 && errno==EINTR ) {
+            continue;
+        } else if( n<0 && errno==EAGAIN ) {
+            m_stdinNotifier->setEnabled( true );
+            return;
+        } else {
+            // The child does not read its stdin anymore.
+            m_writeBuffer.clear();
+            m_closeWrite = true;
+        }
+    }
+
+    if( m_stdinNotifier )
+        m_stdinNotifier->setEnabled( false );
+
+    if( m_closeWrite && m_stdin>=0 ) {
+        dropNotifier( &m_stdinNotifier );
+        closeFd( &m_stdin );
+    }
+}
+
+
+void KTimerProcess::readOutput()
+{
+    if( drain( &m_stdout, &m_stdoutNotifier, m_outRing, m_detached ? 0 : &m_readBuffer ) && !m_outRing )
+        emit readyReadStandardOutput();
+}
+
+
+void KTimerProcess::readErrors()
+{
+    drain( &m_stderr, &m_stderrNotifier, m_errRing, 0 );
+}
+
+
+// Reads what is available on one of our ends into the ring, if any, or the
+// buffer; with neither the data is dropped.
+bool KTimerProcess::drain( int *fd, QSocketNotifier **notifier, KTimerRingBuffer *ring, QByteArray *buffer )
+{
+    bool got = false;
+    char chunk[4096];
+
+    while( *fd>=0 ) {
+        const ssize_t n = ::read( *fd, chunk, sizeof( chunk ) );
+        if( n>0 ) {
+            if( ring )
+                ring->append( chunk, n );
+            else if( buffer )
+                buffer->append( chunk, n );
+            got = true;
+        } else if( n<0 && errno==EINTR ) {
+            continue;
+        } else {
+            if( n==0 ) {
+                dropNotifier( notifier );
+                closeFd( fd );
+            }
+            break;
+        }
+    }
+
+    return got;
+}
+
+
+void KTimerProcess::reap()
+{
+    if( m_pid<=0 )
+        return;
+
+    // Leftovers of a command that had to be stopped by the watchdog go as
+    // well, before the child is reaped: until then its pid, and with it the
+    // process group, cannot be taken by another process.
+    if( m_timedOut ) {
+        siginfo_t info;
+        info.si_pid = 0;
+        int ret;
+        do {
+            ret = ::waitid( P_PID, (id_t)m_pid, &info, WEXITED | WNOHANG | WNOWAIT );
+        } while( ret<0 && errno==EINTR );
+        if( ret==0 && info.si_pid==0 )
+            return;
+        ::kill( -(pid_t)m_pid, SIGKILL );
+    }
+
+    int status = 0;
+    struct rusage ru;
+    pid_t pid;
+    do {
+        pid = ::wait4( (pid_t)m_pid, &status, WNOHANG, &ru );
+    } while( pid<0 && errno==EINTR );
+
+    if( pid==0 )
+        return;
+
+    m_pid = 0;
+    m_usage.wallMs = (quint32)m_clock.elapsed();
+    if( pid>0 ) {
+        m_usage.userMs = (quint32)( ru.ru_utime.tv_sec*1000 + ru.ru_utime.tv_usec/1000 );
+        m_usage.systemMs = (quint32)( ru.ru_stime.tv_sec*1000 + ru.ru_stime.tv_usec/1000 );
+        m_usage.maxRssKb = (quint32)ru.ru_maxrss;  // NB: KiB on Linux
+    }
+    if( m_exitPoll )
+        m_exitPoll->stop();
+    if( m_watchdog )
+        m_watchdog->stop();
+
+    // Whatever the child wrote is in the pipes by now.
+    readOutput();
+    readErrors();
+    teardown();
+
+    if( pid>0 && WIFEXITED( status ) )
+        emit finished( WEXITSTATUS( status ), QProcess::NormalExit );
+    else
+        emit finished( pid>0 && WIFSIGNALED( status ) ? WTERMSIG( status ) : -1, QProcess::CrashExit );
+}
+
+
+void KTimerProcess::watchdog()
+{
+    if( m_pid<=0 )
+        return;
+
+    // First ask politely, then insist.
+    if( !m_timedOut ) {
+        m_timedOut = true;
+        ::kill( -(pid_t)m_pid, SIGTERM );
+        m_watchdog->start( 5000 );
+    } else {
+        ::kill( -(pid_t)m_pid, SIGKILL );
+    }
+}
+
+
+void KTimerProcess::teardown()
+{
+    dropNotifier( &m_stdinNotifier );
+    dropNotifier( &m_stdoutNotifier );
+    dropNotifier( &m_stderrNotifier );
+    dropNotifier( &m_exitNotifier );
+    closeFd( &m_stdin );
+    closeFd( &m_stdout );
+    closeFd( &m_stderr );
+    closeFd( &m_pidfd );
+
+    m_writeBuffer.clear();
+    m_closeWrite = false;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERPROCESS_H_INCLUDED
+#define KTIMERPROCESS_H_INCLUDED
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QProcess>
+
+#include "ktimerusage.h"
+
+class QSocketNotifier;
+class QTimer;
+class KTimerRingBuffer;
+class KTimerProcess;
+
+/**
+ * Stands in for fork() and exec(), see KTimerProcess::setLauncher().
+ */
+class KTimerLauncher {
+ public:
+    virtual ~KTimerLauncher() {}
+    // Pretends to start the command; the run is ended with KTimerProcess::setFinished().
+    virtual bool launch( KTimerProcess *proc, const QString &command ) = 0;
+};
+
+/**
+ * A child process started by ktimer.
+ *
+ * Unlike QProcess this gives us the file descriptors the child runs with:
+ * by default stdin is /dev/null and stdout/stderr are inherited from ktimer,
+ * but each can be handed an arbitrary descriptor (which is dup'ed into the
+ * child), be piped to and from ktimer, or have its output captured into a
+ * ring buffer owned by the caller.
+ *
+ * The command line is split like a shell would do it, without expansions.
+ * Children are reaped with wait4(), which gives us their resource usage.
+ *
+ * Every child leads its own process group, so that the watchdog (see
+ * setMaxRuntime()) can take down whatever the command started as well.
+ */
+class KTimerProcess : public QObject {
+ Q_OBJECT
+
+ public:
+    enum SchedulingClass { NormalScheduling, BatchScheduling, IdleScheduling };
+
+    explicit KTimerProcess( QObject *parent=0 );
+    virtual ~KTimerProcess();
+
+    // Must be called before start().
+    void setStandardInputFd( int fd );
+    void setStandardInputPiped();
+    void setStandardOutputFd( int fd );
+    void setStandardOutputPiped();
+    void setStandardOutputCapture( KTimerRingBuffer *ring );
+    void setStandardErrorCapture( KTimerRingBuffer *ring );
+
+    // The child's nice level relative to ktimer and its CPU scheduling policy;
+    // the I/O priority follows from both. Raising the priority is best effort.
+    void setPriority( int niceIncrement, SchedulingClass scheduling );
+
+    // After msec the process group gets SIGTERM, and SIGKILL a few seconds later; 0 disables.
+    void setMaxRuntime( int msec );
+    // Whether the watchdog had to step in during the last run.
+    bool timedOut() const;
+    // Whether the last run, which finished with 'status', counts as a success
+    // of the job(s) it ran for: it exited by itself, in time. The exit code does not count.
+    bool succeeded( QProcess::ExitStatus status ) const;
+
+    // Stop using the caller's ring buffers and delete ourselves once the child exits.
+    void detach();
+
+    // Hands every start() to the launcher instead of forking, or forks again for 0.
+    // The launcher is not owned.
+    static void setLauncher( KTimerLauncher *launcher );
+    // Ends a run started by the launcher.
+    void setFinished( int exitCode, QProcess::ExitStatus status, const KTimerUsage &usage );
+
+    bool start( const QString &command );
+    bool isRunning() const;
+    qint64 processId() const;
+    // Of the last run, valid once finished() was emitted.
+    KTimerUsage usage() const;
+
+    void terminate();
+    void kill();
+
+    // Piped stdin.
+    void write( const QByteArray &data );
+    void closeWriteChannel();
+
+    // Piped stdout.
+    bool canReadLine() const;
+    QByteArray readLine();
+    QByteArray readAll();
+
+ signals:
+    void readyReadStandardOutput();
+    void finished( int exitCode, QProcess::ExitStatus status );
+
+ private slots:
+    void flushInput();
+    void readOutput();
+    void readErrors();
+    void reap();
+    void watchdog();
+
+ private:
+    bool drain( int *fd, QSocketNotifier **notifier, KTimerRingBuffer *ring, QByteArray *buffer );
+    void teardown();
+
+    qint64 m_pid;
+    bool m_launched;            // by the launcher, instead of m_pid
+    int m_inFd, m_outFd;            // given to the child, not owned
+    bool m_inPiped, m_outPiped;
+    bool m_detached;
+    KTimerRingBuffer *m_outRing, *m_errRing;
+    int m_stdin, m_stdout, m_stderr, m_pidfd; // our ends, owned
+    bool m_closeWrite;
+    QByteArray m_writeBuffer;
+    QByteArray m_readBuffer;
+    QElapsedTimer m_clock;
+    KTimerUsage m_usage;
+    int m_niceIncrement;
+    SchedulingClass m_scheduling;
+    int m_maxRuntime;
+    bool m_timedOut;
+    QTimer *m_watchdog;
+
+    QSocketNotifier *m_stdinNotifier;
+    QSocketNotifier *m_stdoutNotifier;
+    QSocketNotifier *m_stderrNotifier;
+    QSocketNotifier *m_exitNotifier;
+    QTimer *m_exitPoll;
+};
+
+#endif
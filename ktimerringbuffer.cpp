@@ -0,0 +1,115 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerringbuffer.h"
+
+#include <string.h>
+
+KTimerRingBuffer::KTimerRingBuffer( int capacity )
+{
+    m_capacity = qMax( capacity, 0 );
+    m_start = 0;
+    m_size = 0;
+    m_total = 0;
+}
+
+
+int KTimerRingBuffer::capacity() const
+{
+    return m_capacity;
+}
+
+
+void KTimerRingBuffer::setCapacity( int capacity )
+{
+    if( m_capacity!=capacity ) {
+        m_capacity = qMax( capacity, 0 );
+        m_data = QByteArray();
+        clear();
+    }
+}
+
+
+int KTimerRingBuffer::size() const
+{
+    return m_size;
+}
+
+
+bool KTimerRingBuffer::isEmpty() const
+{
+    return m_size==0;
+}
+
+
+qint64 KTimerRingBuffer::dropped() const
+{
+    return m_total - m_size;
+}
+
+
+void KTimerRingBuffer::append( const char *data, int len )
+{
+    if( len<=0 )
+        return;
+
+    m_total += len;
+    if( m_capacity==0 )
+        return;
+
+    if( m_data.size()!=m_capacity )
+        m_data.resize( m_capacity );
+
+    if( len>=m_capacity ) {
+        memcpy( m_data.data(), data + len - m_capacity, m_capacity );
+        m_start = 0;
+        m_size = m_capacity;
+        return;
+    }
+
+    const int end = ( m_start + m_size ) % m_capacity;
+    const int first = qMin( len, m_capacity - end );
+    memcpy( m_data.data() + end, data, first );
+    memcpy( m_data.data(), data + first, len - first );
+
+    m_size += len;
+    if( m_size>m_capacity ) {
+        m_start = ( m_start + m_size - m_capacity ) % m_capacity;
+        m_size = m_capacity;
+    }
+}
+
+
+void KTimerRingBuffer::clear()
+{
+    m_start = 0;
+    m_size = 0;
+    m_total = 0;
+}
+
+
+QByteArray KTimerRingBuffer::toByteArray() const
+{
+    const int first = qMin( m_size, m_capacity - m_start );
+
+    QByteArray data;
+    data.reserve( m_size );
+    data.append( m_data.constData() + m_start, first );
+    data.append( m_data.constData(), m_size - first );
+    return data;
+}
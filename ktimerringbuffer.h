@@ -0,0 +1,54 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERRINGBUFFER_H_INCLUDED
+#define KTIMERRINGBUFFER_H_INCLUDED
+
+#include <QByteArray>
+
+/**
+ * Keeps the last capacity() bytes appended to it, and nothing more.
+ *
+ * The storage is allocated on the first append and never grows, so a
+ * chatty command costs the same as a quiet one.
+ */
+class KTimerRingBuffer {
+ public:
+    explicit KTimerRingBuffer( int capacity=0 );
+
+    int capacity() const;
+    void setCapacity( int capacity );
+
+    int size() const;
+    bool isEmpty() const;
+    // Bytes appended since the last clear() that were pushed out again.
+    qint64 dropped() const;
+
+    void append( const char *data, int len );
+    void clear();
+    QByteArray toByteArray() const;
+
+ private:
+    QByteArray m_data;
+    int m_capacity;
+    int m_start;
+    int m_size;
+    qint64 m_total;
+};
+
+#endif
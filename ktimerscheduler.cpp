@@ -0,0 +1,514 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerscheduler.h"
+#include "ktimer.h"
+#include "ktimer_debug.h"
+#include "ktimergroup.h"
+
+#include <limits.h>
+
+#include <algorithm>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMultiMap>
+#include <QPair>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+#ifdef Q_OS_LINUX
+#include <sys/prctl.h>
+#endif
+
+// The kernel timer slack is per thread: it delays every timer of the GUI
+// thread, the watchdogs, batch windows and the like as well as ours. It is
+// kept to what none of them minds; the coalescing is done by the windows.
+static const qint64 s_maxKernelSlack = 50;
+
+// Runs owed to a job, as long as it stays in the state it was in when they were.
+struct KTimerCatchUp {
+    QPointer<KTimerJob> job;
+    unsigned runs;
+    int state;
+};
+
+// The running jobs of one group, with deadlines on the group's clock.
+struct KTimerQueue {
+    KTimerQueue() : maxSlack( 0 ) {}
+
+    QMultiMap<qint64, KTimerJob *> index;   // deadline -> job
+    QHash<KTimerJob *, qint64> deadlines;
+    qint64 maxSlack;                        // largest slack in 'index', msecs
+};
+
+struct KTimerSchedulerPrivate {
+    QHash<KTimerGroup *, KTimerQueue> queues;
+    bool dispatching;
+    bool interactive;
+    qint64 kernelSlack;                     // currently applied, msecs; 0 is the default
+
+    QElapsedTimer clock;
+    KTimerClock *virtualClock;
+    qint64 nextWakeup;
+    QTimer *timer;
+    quint64 wakeups;
+    quint64 watchdogKills;
+
+    QList<KTimerCatchUp> catchUps;
+    QTimer *catchUpTimer;
+    unsigned catchUpRate;                   // per minute
+
+    bool following;
+    QList<QPair<QPointer<KTimerJob>, qint64> > heldBack;        // job, msecs since the epoch
+};
+
+
+KTimerScheduler::KTimerScheduler( QObject *parent )
+    : QObject( parent )
+{
+    d = new KTimerSchedulerPrivate;
+    d->dispatching = false;
+    d->interactive = false;
+    d->kernelSlack = 0;
+    d->wakeups = 0;
+    d->watchdogKills = 0;
+    d->clock.start();
+    d->virtualClock = 0;
+    d->nextWakeup = -1;
+
+    d->timer = new QTimer( this );
+    d->timer->setSingleShot( true );
+    // We do our own coalescing, don't let Qt move the wakeup around on top of it.
+    d->timer->setTimerType( Qt::PreciseTimer );
+    connect(d->timer, &QTimer::timeout, this, &KTimerScheduler::wakeup);
+
+    d->catchUpRate = 60;
+    d->catchUpTimer = new QTimer( this );
+    d->catchUpTimer->setInterval( 60000 / d->catchUpRate );
+    connect(d->catchUpTimer, &QTimer::timeout, this, &KTimerScheduler::catchUpNext);
+
+    d->following = false;
+}
+
+
+KTimerScheduler::~KTimerScheduler()
+{
+    applyTimerSlack( 0 );
+    delete d;
+}
+
+
+KTimerScheduler *KTimerScheduler::self()
+{
+    static KTimerScheduler *s_self = 0;
+    if( !s_self )
+        s_self = new KTimerScheduler( QCoreApplication::instance() );
+    return s_self;
+}
+
+
+qint64 KTimerScheduler::now() const
+{
+    return d->virtualClock ? d->virtualClock->now() : d->clock.elapsed();
+}
+
+
+void KTimerScheduler::schedule( KTimerJob *job, qint64 deadline )
+{
+    unschedule( job );
+
+    KTimerQueue &queue = d->queues[job->group()];
+    queue.index.insert( deadline, job );
+    queue.deadlines.insert( job, deadline );
+    queue.maxSlack = qMax( queue.maxSlack, job->slack() * 1000LL );
+    rearm();
+}
+
+
+void KTimerScheduler::unschedule( KTimerJob *job )
+{
+    QHash<KTimerGroup *, KTimerQueue>::iterator queue = d->queues.find( job->group() );
+    if( queue == d->queues.end() )
+        return;
+
+    QHash<KTimerJob *, qint64>::iterator it = queue->deadlines.find( job );
+    if( it == queue->deadlines.end() )
+        return;
+
+    queue->index.remove( it.value(), job );
+    queue->deadlines.erase( it );
+    rearm();
+}
+
+
+void KTimerScheduler::clear( KTimerGroup *group )
+{
+    // The jobs notice they were stopped the next time they are looked at,
+    // KTimerJob::jobs() by the generation of the group.
+
+    // Stopping the global group stops everything.
+    if( group->isGlobal() )
+        d->queues.clear();
+    else
+        d->queues.remove( group );
+    rearm();
+}
+
+
+bool KTimerScheduler::isScheduled( const KTimerJob *job ) const
+{
+    return deadline( job )!=-1;
+}
+
+
+qint64 KTimerScheduler::deadline( const KTimerJob *job ) const
+{
+    QHash<KTimerGroup *, KTimerQueue>::const_iterator queue = d->queues.constFind( job->group() );
+    if( queue == d->queues.constEnd() )
+        return -1;
+    return queue->deadlines.value( const_cast<KTimerJob *>( job ), -1 );
+}
+
+
+qint64 KTimerScheduler::expiry( const KTimerJob *job ) const
+{
+    const qint64 deadline = this->deadline( job );
+    if( deadline<0 || !job->group()->isRunning() )
+        return -1;
+    return deadline - job->group()->time() + now();
+}
+
+
+QList<KTimerJob *> KTimerScheduler::upcoming( qint64 msec, int limit ) const
+{
+    // A cursor into the queue of every running group, merged on the common clock.
+    struct Cursor {
+        QMultiMap<qint64, KTimerJob *>::const_iterator it;
+        QMultiMap<qint64, KTimerJob *>::const_iterator end;
+        qint64 offset;      // from the group's clock to ours
+    };
+
+    const qint64 now = this->now();
+    QVector<Cursor> cursors;
+    for( QHash<KTimerGroup *, KTimerQueue>::const_iterator queue = d->queues.constBegin(); queue != d->queues.constEnd(); ++queue ) {
+        if( !queue.key()->isRunning() )
+            continue;
+        Cursor cursor;
+        cursor.offset = now - queue.key()->time();
+        cursor.it = queue->index.constBegin();
+        cursor.end = queue->index.upperBound( now + msec - cursor.offset );
+        if( cursor.it != cursor.end )
+            cursors.append( cursor );
+    }
+
+    QList<KTimerJob *> jobs;
+    while( !cursors.isEmpty() && ( limit<0 || jobs.count()<limit ) ) {
+        int next = 0;
+        for( int i=1; i<cursors.count(); ++i ) {
+            if( cursors.at( i ).it.key() + cursors.at( i ).offset < cursors.at( next ).it.key() + cursors.at( next ).offset )
+                next = i;
+        }
+        jobs.append( cursors.at( next ).it.value() );
+        if( ++cursors[next].it == cursors.at( next ).end )
+            cursors.remove( next );
+    }
+    return jobs;
+}
+
+
+void KTimerScheduler::setClock( KTimerClock *clock )
+{
+    d->virtualClock = clock;
+    d->timer->stop();
+    applyTimerSlack( 0 );
+    rearm();
+}
+
+
+qint64 KTimerScheduler::nextWakeup() const
+{
+    return d->nextWakeup;
+}
+
+
+int KTimerScheduler::count() const
+{
+    int n = 0;
+    for( QHash<KTimerGroup *, KTimerQueue>::const_iterator queue = d->queues.constBegin(); queue != d->queues.constEnd(); ++queue )
+        n += queue->deadlines.count();
+    return n;
+}
+
+
+bool KTimerScheduler::isInteractive() const
+{
+    return d->interactive;
+}
+
+
+void KTimerScheduler::setInteractive( bool interactive )
+{
+    if( d->interactive!=interactive ) {
+        d->interactive = interactive;
+        rearm();
+    }
+}
+
+
+quint64 KTimerScheduler::wakeups() const
+{
+    return d->wakeups;
+}
+
+
+double KTimerScheduler::wakeupsPerSecond() const
+{
+    const qint64 elapsed = now();
+    return elapsed>0 ? d->wakeups * 1000.0 / elapsed : 0.0;
+}
+
+
+quint64 KTimerScheduler::watchdogKills() const
+{
+    return d->watchdogKills;
+}
+
+
+void KTimerScheduler::countWatchdogKill()
+{
+    ++d->watchdogKills;
+}
+
+
+void KTimerScheduler::catchUp( KTimerJob *job, unsigned runs )
+{
+    // The leader catches up, from the same saved state.
+    if( runs==0 || d->following )
+        return;
+    const KTimerCatchUp owed = { job, runs, job->state() };
+    d->catchUps.append( owed );
+    if( !d->catchUpTimer->isActive() )
+        d->catchUpTimer->start();
+}
+
+
+int KTimerScheduler::pendingCatchUps() const
+{
+    int runs = 0;
+    for( int i=0; i<d->catchUps.count(); ++i )
+        runs += d->catchUps.at( i ).runs;
+    return runs;
+}
+
+
+unsigned KTimerScheduler::catchUpRate() const
+{
+    return d->catchUpRate;
+}
+
+
+void KTimerScheduler::setCatchUpRate( unsigned perMinute )
+{
+    d->catchUpRate = qBound( 1u, perMinute, 60000u );
+    d->catchUpTimer->setInterval( 60000 / d->catchUpRate );
+}
+
+
+// One run per tick, taking turns between the jobs.
+void KTimerScheduler::catchUpNext()
+{
+    while( !d->catchUps.isEmpty() ) {
+        KTimerCatchUp next = d->catchUps.takeFirst();
+        // Deleted, or stopped, started or paused by hand meanwhile: it is owed nothing anymore.
+        if( !next.job || next.job->state()!=next.state || !next.job->group()->isRunning() )
+            continue;
+
+        // A oneInstance job would skip a run while the last one goes on: not one to count.
+        if( next.job->isBusy() ) {
+            d->catchUps.append( next );
+            break;
+        }
+
+        if( --next.runs>0 )
+            d->catchUps.append( next );
+        next.job->fire();
+        break;
+    }
+
+    if( d->catchUps.isEmpty() )
+        d->catchUpTimer->stop();
+}
+
+
+bool KTimerScheduler::isFollowing() const
+{
+    return d->following;
+}
+
+
+void KTimerScheduler::setFollowing( bool following )
+{
+    d->following = following;
+    d->heldBack.clear();
+}
+
+
+void KTimerScheduler::holdBack( KTimerJob *job )
+{
+    // Only the last moments matter, see takeOver().
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while( !d->heldBack.isEmpty() && d->heldBack.first().second<now-60000 )
+        d->heldBack.removeFirst();
+    d->heldBack.append( qMakePair( QPointer<KTimerJob>( job ), now ) );
+}
+
+
+void KTimerScheduler::takeOver( qint64 since )
+{
+    const QList<QPair<QPointer<KTimerJob>, qint64> > heldBack = d->heldBack;
+    setFollowing( false );
+
+    for( int i=0; i<heldBack.count(); ++i ) {
+        if( heldBack.at( i ).first && heldBack.at( i ).second>=since )
+            heldBack.at( i ).first->fire();
+    }
+}
+
+
+void KTimerScheduler::rearm()
+{
+    if( d->dispatching )
+        return;
+
+    // Intersect the windows [deadline-slack, deadline+slack] of the earliest
+    // expiries for as long as they overlap; everything in there shares one wakeup.
+    // Each group does so on its own clock, then the windows of the groups are
+    // merged the same way on ours.
+    const qint64 t = now();
+    QMultiMap<qint64, qint64> windows;  // lo -> hi
+    for( QHash<KTimerGroup *, KTimerQueue>::const_iterator queue = d->queues.constBegin(); queue != d->queues.constEnd(); ++queue ) {
+        if( queue->index.isEmpty() || !queue.key()->isRunning() )
+            continue;
+
+        QMultiMap<qint64, KTimerJob *>::const_iterator it = queue->index.constBegin();
+        qint64 slack = it.value()->slack() * 1000LL;
+        qint64 lo = it.key() - slack;
+        qint64 hi = it.key() + slack;
+        for( ++it; it != queue->index.constEnd() && it.key() <= hi + queue->maxSlack; ++it ) {
+            slack = it.value()->slack() * 1000LL;
+            if( it.key() - slack > hi )
+                continue;
+            lo = qMax( lo, it.key() - slack );
+            hi = qMin( hi, it.key() + slack );
+        }
+
+        const qint64 lag = t - queue.key()->time();
+        windows.insert( lo + lag, hi + lag );
+    }
+
+    if( windows.isEmpty() ) {
+        d->nextWakeup = -1;
+        d->timer->stop();
+        applyTimerSlack( 0 );
+        return;
+    }
+
+    QMultiMap<qint64, qint64>::const_iterator it = windows.constBegin();
+    qint64 lo = it.key();
+    qint64 hi = it.value();
+    for( ++it; it != windows.constEnd() && it.key() <= hi; ++it )
+        hi = qMin( hi, it.value() );
+    for( it = windows.constBegin(); it != windows.constEnd() && it.key() <= hi; ++it )
+        lo = qMax( lo, it.key() );
+
+    d->nextWakeup = lo;
+    if( d->virtualClock )
+        return;
+
+    // Arm for the opening of the window and let the kernel pick the moment
+    // within a little of it, or up to its end if that is sooner.
+    d->timer->start( (int)qBound<qint64>( 0, lo - t, INT_MAX ) );
+    applyTimerSlack( qMin( hi - qMax( lo, t ), s_maxKernelSlack ) );
+}
+
+
+void KTimerScheduler::applyTimerSlack( qint64 msec )
+{
+    if( d->interactive || msec < 0 )
+        msec = 0;
+
+    if( msec==d->kernelSlack )
+        return;
+    d->kernelSlack = msec;
+
+#ifdef Q_OS_LINUX
+    // NB: zero restores the default slack of the thread.
+    const unsigned long nsec = (unsigned long)qMin<quint64>( msec * 1000000ULL, ULONG_MAX );
+    prctl( PR_SET_TIMERSLACK, nsec, 0, 0, 0 );
+#endif
+}
+
+
+void KTimerScheduler::wakeup()
+{
+    ++d->wakeups;
+    const qint64 t = now();
+
+    // Deadlines moved onto our clock, so that those of different groups compare.
+    QVector<QPair<qint64, KTimerJob *> > due;
+    for( QHash<KTimerGroup *, KTimerQueue>::const_iterator queue = d->queues.constBegin(); queue != d->queues.constEnd(); ++queue ) {
+        if( !queue.key()->isRunning() )
+            continue;
+
+        const qint64 gt = queue.key()->time();
+        for( QMultiMap<qint64, KTimerJob *>::const_iterator it = queue->index.constBegin();
+             it != queue->index.constEnd() && it.key() <= gt + queue->maxSlack; ++it ) {
+            if( it.key() - it.value()->slack() * 1000LL <= gt )
+                due.append( qMakePair( it.key() + t - gt, it.value() ) );
+        }
+    }
+
+    // Of the jobs expiring in this wakeup, whatever their group, the more
+    // important ones get to start their commands first; otherwise by deadline.
+    // Jobs whose slack lets them wait for a later wakeup are not in here.
+    std::stable_sort( due.begin(), due.end(), []( const QPair<qint64, KTimerJob *> &a, const QPair<qint64, KTimerJob *> &b ) {
+        if( a.second->priority()!=b.second->priority() )
+            return a.second->priority() > b.second->priority();
+        return a.first < b.first;
+    });
+
+    qCDebug(KTIMER_LOG) << "wakeup" << d->wakeups << "expires" << due.count() << "of" << count()
+                        << "jobs," << wakeupsPerSecond() << "wakeups/s";
+
+    // Expiring may reschedule (loop) or start other jobs (consecutive), rearm once at the end.
+    d->dispatching = true;
+    for( int i=0; i<due.count(); ++i ) {
+        KTimerJob *job = due.at( i ).second;
+        if( !isScheduled( job ) )
+            continue;
+        unschedule( job );
+        job->timeout();
+    }
+    d->dispatching = false;
+
+    rearm();
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERSCHEDULER_H_INCLUDED
+#define KTIMERSCHEDULER_H_INCLUDED
+
+#include <QObject>
+
+class KTimerGroup;
+class KTimerJob;
+
+/**
+ * A clock the scheduler can run on instead of the monotonic clock of the system.
+ *
+ * Nothing happens by itself on such a clock: whoever drives it advances it
+ * to KTimerScheduler::nextWakeup() and calls KTimerScheduler::wakeup().
+ * This is how ktimer_sim replays days of load in seconds.
+ */
+class KTimerClock {
+ public:
+    virtual ~KTimerClock() {}
+    // Milliseconds, never going backwards.
+    virtual qint64 now() const = 0;
+};
+
+/**
+ * Drives every running KTimerJob from a single timer.
+ *
+ * Each job is handed in with an absolute deadline and keeps its own slack
+ * (see KTimerJob::slack()). Instead of waking once a second per job, the
+ * scheduler sleeps until the window shared by the earliest expiries opens,
+ * lets the kernel defer the wakeup by a little more, to line it up with
+ * other wakeups of the system, and then expires every job whose window has
+ * been reached in one go.
+ *
+ * Deadlines are kept per KTimerGroup, on the clock of the job's group, so
+ * that pausing a group is a matter of not looking at its queue.
+ */
+class KTimerScheduler : public QObject {
+ Q_OBJECT
+
+ public:
+    explicit KTimerScheduler( QObject *parent=0 );
+    virtual ~KTimerScheduler();
+
+    static KTimerScheduler *self();
+
+    // Monotonic time in milliseconds; the clocks of the groups derive from it.
+    qint64 now() const;
+
+    // Deadlines are on the clock of the job's group, see KTimerGroup::time().
+    void schedule( KTimerJob *job, qint64 deadline );
+    void unschedule( KTimerJob *job );
+    // Drops every job of the group, or of all groups for the global one.
+    void clear( KTimerGroup *group );
+    bool isScheduled( const KTimerJob *job ) const;
+    qint64 deadline( const KTimerJob *job ) const;
+    int count() const;
+
+    // When the job runs out, on the clock of now(); -1 if it is not counting down,
+    // also while its group is paused.
+    qint64 expiry( const KTimerJob *job ) const;
+    // The jobs running out within the next 'msec', soonest first, at most
+    // 'limit' of them; O(log n + k) for k jobs over the few groups.
+    QList<KTimerJob *> upcoming( qint64 msec, int limit=-1 ) const;
+
+    // Runs the scheduler on the given clock, or on the system clock again for 0.
+    // The clock is not owned; jobs should not be running while switching.
+    void setClock( KTimerClock *clock );
+    // When the scheduler wants to wake up next, on its clock; -1 for never.
+    qint64 nextWakeup() const;
+
+    // While interactive the process keeps the default kernel timer slack,
+    // so that a visible UI is not delayed by the slack of the timers.
+    bool isInteractive() const;
+    void setInteractive( bool interactive );
+
+    // Instrumentation: number of scheduler wakeups since startup.
+    quint64 wakeups() const;
+    double wakeupsPerSecond() const;
+    // Runs that had to be stopped for exceeding their maximum runtime.
+    quint64 watchdogKills() const;
+    void countWatchdogKill();
+
+    // Fires the job 'runs' more times for expiries missed while ktimer was not
+    // running. Catch-up runs of all jobs take turns, at most catchUpRate() a
+    // minute, so that a restart after a long outage does not start everything at once.
+    // The runs are dropped once the job leaves the state it is in now, or its
+    // group is paused; a run that a oneInstance job is still busy with does not count.
+    void catchUp( KTimerJob *job, unsigned runs );
+    int pendingCatchUps() const;
+    unsigned catchUpRate() const;
+    void setCatchUpRate( unsigned perMinute );
+
+    // While following, another ktimer runs the jobs (see KTimerLeader): the
+    // jobs count down as usual, but their runs are only noted, not started.
+    bool isFollowing() const;
+    void setFollowing( bool following );
+    void holdBack( KTimerJob *job );
+    // Stops following, and starts the runs held back since 'since' (msecs since
+    // the epoch), which the leader that went away may not have got to.
+    void takeOver( qint64 since );
+
+ public slots:
+    // Expires whatever is due; called by our own timer unless on a KTimerClock.
+    void wakeup();
+
+ private slots:
+    void catchUpNext();
+
+ private:
+    friend class KTimerGroup;
+    void rearm();
+    void applyTimerSlack( qint64 msec );
+
+    struct KTimerSchedulerPrivate *d;
+};
+
+#endif
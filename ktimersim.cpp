@@ -0,0 +1,273 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * ktimer_sim: replays a generated load against the real scheduler and jobs,
+ * on a virtual clock and with a stub launcher instead of fork() and exec().
+ *
+ * Everything printed on stdout only depends on the options, so two runs can
+ * be diffed; the CPU time it took goes to stderr.
+ */
+
+#include "ktimer.h"
+#include "ktimerprocess.h"
+#include "ktimerscheduler.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <random>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QHash>
+#include <QMultiMap>
+#include <QPointer>
+#include <QTextStream>
+#include <QVector>
+
+class SimClock : public KTimerClock {
+ public:
+    SimClock() : m_now( 0 ) {}
+    qint64 now() const Q_DECL_OVERRIDE { return m_now; }
+    void advance( qint64 msec ) { m_now = qMax( m_now, msec ); }
+
+ private:
+    qint64 m_now;
+};
+
+
+// The command of a simulated job is "sim <runtime ms> <exit code>".
+class SimLauncher : public KTimerLauncher {
+ public:
+    explicit SimLauncher( const SimClock *clock ) : launched( 0 ), maxRunning( 0 ), m_clock( clock ) {}
+
+    bool launch( KTimerProcess *proc, const QString &command ) Q_DECL_OVERRIDE
+    {
+        const QStringList args = command.split( QLatin1Char( ' ' ) );
+        Run run;
+        run.proc = proc;
+        run.runtime = args.value( 1 ).toUInt();
+        run.exitCode = args.value( 2 ).toInt();
+        m_running.insert( m_clock->now() + run.runtime, run );
+
+        ++launched;
+        maxRunning = qMax( maxRunning, m_running.count() );
+        return true;
+    }
+
+    qint64 nextExit() const
+    {
+        return m_running.isEmpty() ? -1 : m_running.constBegin().key();
+    }
+
+    void exitDue()
+    {
+        while( !m_running.isEmpty() && m_running.constBegin().key() <= m_clock->now() ) {
+            const Run run = m_running.take( m_running.constBegin().key() );
+            if( !run.proc )
+                continue;
+
+            KTimerUsage usage = KTimerUsage();
+            usage.userMs = run.runtime / 2;
+            usage.systemMs = run.runtime / 8;
+            usage.wallMs = run.runtime;
+            run.proc->setFinished( run.exitCode, QProcess::NormalExit, usage );
+        }
+    }
+
+    quint64 launched;
+    int maxRunning;
+
+ private:
+    struct Run {
+        QPointer<KTimerProcess> proc;
+        quint32 runtime;
+        int exitCode;
+    };
+
+    const SimClock *m_clock;
+    QMultiMap<qint64, Run> m_running;     // exit time -> run
+};
+
+
+// Nearest rank, like KTimerUsageStats.
+static qint64 percentile( const QVector<qint64> &sorted, int p )
+{
+    if( sorted.isEmpty() )
+        return 0;
+    const int rank = qMax( 1, ( p * sorted.count() + 99 ) / 100 );
+    return sorted.at( rank-1 );
+}
+
+
+int main( int argc, char **argv )
+{
+    QCoreApplication app( argc, argv );
+    QCoreApplication::setApplicationName( QStringLiteral( "ktimer_sim" ) );
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription( QStringLiteral( "Replays a generated load against the ktimer scheduler on a virtual clock." ) );
+    parser.addHelpOption();
+    parser.addOption( QCommandLineOption( QStringLiteral( "jobs" ), QStringLiteral( "Number of jobs." ), QStringLiteral( "n" ), QStringLiteral( "2000" ) ) );
+    parser.addOption( QCommandLineOption( QStringLiteral( "days" ), QStringLiteral( "Simulated time." ), QStringLiteral( "days" ), QStringLiteral( "1" ) ) );
+    parser.addOption( QCommandLineOption( QStringLiteral( "seed" ), QStringLiteral( "Seed of the generated load." ), QStringLiteral( "seed" ), QStringLiteral( "1" ) ) );
+    parser.process( app );
+
+    const int jobCount = qMax( 1, parser.value( QStringLiteral( "jobs" ) ).toInt() );
+    const int days = qMax( 1, parser.value( QStringLiteral( "days" ) ).toInt() );
+    const quint32 seed = parser.value( QStringLiteral( "seed" ) ).toUInt();
+    const qint64 end = days * 86400000LL;
+
+    SimClock clock;
+    SimLauncher launcher( &clock );
+    KTimerScheduler *scheduler = KTimerScheduler::self();
+    scheduler->setClock( &clock );
+    KTimerProcess::setLauncher( &launcher );
+
+    // NB: only the raw output of the engine is portable, not the std distributions.
+    std::mt19937 rng( seed );
+    static const unsigned delays[] = { 10, 60, 300, 900, 3600, 6*3600, 86400 };
+
+    QVector<KTimerJob *> jobs;
+    jobs.reserve( jobCount );
+    for( int i=0; i<jobCount; ++i ) {
+        KTimerJob *job = new KTimerJob;
+        const unsigned base = delays[rng() % ( sizeof( delays ) / sizeof( *delays ) )];
+        const unsigned delay = base + rng() % ( base/10 + 1 );
+        job->setDelay( delay );
+        job->setCaptureSize( 0 );
+        job->setPriority( (KTimerJob::Priority)( rng() % 4 ) );
+        job->setSlack( rng() % 2 ? rng() % ( delay/20 + 1 ) : 0 );
+        job->setOneInstance( rng() % 10 != 0 );
+
+        // A few commands outlive their period, so oneInstance has to skip fires.
+        const quint32 runtime = rng() % 20 == 0 ? delay * 1500 : rng() % 2000;
+        const int exitCode = rng() % 30 == 0 ? 1 : 0;
+        job->setCommand( QStringLiteral( "sim %1 %2" ).arg( runtime ).arg( exitCode ) );
+
+        // Every fourth job follows the one before it, once.
+        const bool follower = i>0 && rng() % 4 == 0;
+        job->setConsecutive( follower );
+        job->setLoop( !follower && rng() % 10 != 0 );
+        jobs.append( job );
+    }
+
+    // What KTimerJobStore does for consecutive jobs.
+    QHash<KTimerJob *, int> indexOf;
+    for( int i=0; i<jobs.count(); ++i )
+        indexOf.insert( jobs.at( i ), i );
+
+    quint64 expiries = 0, fires = 0, failures = 0;
+    QVector<qint64> lateness;
+    QHash<KTimerJob *, qint64> expected;    // deadline of the pending expiry
+    QVector<KTimerJob *> expired;
+
+    for( int i=0; i<jobs.count(); ++i ) {
+        KTimerJob *job = jobs.at( i );
+        QObject::connect(job, &KTimerJob::fired, [&fires]() { ++fires; });
+        QObject::connect(job, &KTimerJob::finished, [&](KTimerJob *done, bool error) {
+            if( error )
+                ++failures;
+            const int next = indexOf.value( done ) + 1;
+            if( next<jobs.count() && jobs.at( next )->consecutive() ) {
+                KTimerJob *follower = jobs.at( next );
+                follower->start();
+                if( scheduler->isScheduled( follower ) )
+                    expected.insert( follower, scheduler->deadline( follower ) );
+            }
+        });
+        // Expiring sets the value to 0 before firing.
+        QObject::connect(job, &KTimerJob::changed, [&](KTimerJob *changed, KTimerJob::Fields fields) {
+            if( ( fields & KTimerJob::Value ) && changed->value()==0 && expected.contains( changed ) ) {
+                ++expiries;
+                lateness.append( clock.now() - expected.take( changed ) );
+                expired.append( changed );
+            }
+        });
+
+        // Spread the first expiries over a whole period.
+        if( !job->consecutive() ) {
+            job->setValue( 1 + rng() % job->delay() );
+            job->start();
+            expected.insert( job, scheduler->deadline( job ) );
+        }
+    }
+
+    const clock_t cpu = ::clock();
+
+    quint64 dueTotal = 0;
+    int dueMax = 0;
+    quint64 scheduledTotal = 0;
+    int scheduledMax = 0;
+    for( ;; ) {
+        const qint64 wakeup = scheduler->nextWakeup();
+        const qint64 exit = launcher.nextExit();
+        if( wakeup<0 && exit<0 )
+            break;
+
+        // Commands exiting at the same time as a wakeup go first.
+        if( exit>=0 && ( wakeup<0 || exit<=wakeup ) ) {
+            if( exit>end )
+                break;
+            clock.advance( exit );
+            launcher.exitDue();
+        } else {
+            if( wakeup>end )
+                break;
+            clock.advance( wakeup );
+
+            const int scheduled = scheduler->count();
+            scheduledTotal += scheduled;
+            scheduledMax = qMax( scheduledMax, scheduled );
+
+            expired.clear();
+            scheduler->wakeup();
+            dueTotal += expired.count();
+            dueMax = qMax( dueMax, expired.count() );
+
+            for( int i=0; i<expired.count(); ++i ) {
+                if( scheduler->isScheduled( expired.at( i ) ) )
+                    expected.insert( expired.at( i ), scheduler->deadline( expired.at( i ) ) );
+            }
+        }
+
+        QCoreApplication::sendPostedEvents( 0, QEvent::DeferredDelete );
+    }
+
+    std::sort( lateness.begin(), lateness.end() );
+    const quint64 wakeups = qMax<quint64>( 1, scheduler->wakeups() );
+
+    QTextStream out( stdout );
+    out << "jobs " << jobCount << ", " << days << " day(s), seed " << seed << "\n";
+    out << "wakeups " << scheduler->wakeups() << " (" << QString::number( scheduler->wakeups() * 1000.0 / end, 'f', 4 ) << "/s)\n";
+    out << "expiries " << expiries << ", fires " << fires << ", skipped " << expiries - qMin( expiries, fires )
+        << ", failed " << failures << "\n";
+    out << "lateness ms: min " << ( lateness.isEmpty() ? 0 : lateness.first() )
+        << " p50 " << percentile( lateness, 50 ) << " p95 " << percentile( lateness, 95 )
+        << " p99 " << percentile( lateness, 99 ) << " max " << ( lateness.isEmpty() ? 0 : lateness.last() ) << "\n";
+    out << "due per wakeup: mean " << QString::number( double( dueTotal ) / wakeups, 'f', 2 ) << " max " << dueMax << "\n";
+    out << "scheduled jobs: mean " << QString::number( double( scheduledTotal ) / wakeups, 'f', 2 ) << " max " << scheduledMax << "\n";
+    out << "running commands: launched " << launcher.launched << " max " << launcher.maxRunning << "\n";
+    out.flush();
+
+    QTextStream( stderr ) << "cpu " << QString::number( double( ::clock() - cpu ) / CLOCKS_PER_SEC, 'f', 2 ) << " s\n";
+
+    KTimerProcess::setLauncher( 0 );
+    return 0;
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimersnapshot.h"
+#include "ktimer_debug.h"
+#include "ktimerleader.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace {
+
+struct Header {
+    char magic[4];
+    quint32 version;
+    quint32 entrySize;      // refuses a layout written by a different build
+    quint32 count;
+    quint64 stamp;
+    quint64 stringsOffset;
+    quint64 stringsSize;
+    quint64 checksum;       // of everything after the header
+};
+
+// An entry of version 2, without the usage strings.
+struct EntryV2 {
+    qint64 expires;
+    quint32 id;
+    quint32 delay;
+    quint32 value;
+    quint32 flags;
+    quint32 captureSize;
+    quint32 slack;
+    quint32 maxRuntime;
+    qint32 priority;
+    qint32 catchUp;
+    quint32 maxCatchUp;
+    qint32 state;
+    quint32 strings[KTimerSnapshot::CommandUsage][2];
+};
+
+}
+
+static const char s_magic[4] = { 'K', 'T', 'S', 'N' };
+static const quint32 s_version = 3;
+
+
+// FNV-1a over 64 bit words: the whole file is hashed on every start, so it
+// has to run at memory speed, and only has to catch damage, not attacks.
+static quint64 checksum( const uchar *data, quint64 size )
+{
+    quint64 hash = Q_UINT64_C( 0xcbf29ce484222325 );
+    quint64 i = 0;
+    for( ; i+8<=size; i+=8 ) {
+        quint64 word;
+        memcpy( &word, data+i, 8 );
+        hash = ( hash ^ word ) * Q_UINT64_C( 0x100000001b3 );
+    }
+    for( ; i<size; ++i )
+        hash = ( hash ^ data[i] ) * Q_UINT64_C( 0x100000001b3 );
+    return hash;
+}
+
+
+KTimerSnapshot::KTimerSnapshot()
+{
+    m_map = 0;
+    m_size = 0;
+    m_entries = 0;
+    m_strings = 0;
+    m_stringsSize = 0;
+    m_count = 0;
+}
+
+
+KTimerSnapshot::~KTimerSnapshot()
+{
+    close();
+}
+
+
+QString KTimerSnapshot::defaultPath()
+{
+    return KTimerLeader::defaultDirectory() + QStringLiteral( "/jobs.snapshot" );
+}
+
+
+bool KTimerSnapshot::open( const QString &path, quint64 stamp )
+{
+    close();
+
+    const int fd = ::open( QFile::encodeName( path ).constData(), O_RDONLY | O_CLOEXEC );
+    if( fd<0 )
+        return false;
+
+    struct stat st;
+    if( ::fstat( fd, &st )<0 || st.st_size<(off_t)sizeof( Header ) ) {
+        ::close( fd );
+        return false;
+    }
+
+    void *map = ::mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+    if( map==MAP_FAILED )
+        return false;
+    m_map = static_cast<uchar *>( map );
+    m_size = st.st_size;
+
+    const Header *header = reinterpret_cast<const Header *>( m_map );
+    const bool v2 = header->version==2;
+    const quint64 entrySize = v2 ? sizeof( EntryV2 ) : sizeof( Entry );
+    const quint64 entriesSize = quint64( header->count ) * entrySize;
+    if( memcmp( header->magic, s_magic, sizeof( s_magic ) )!=0 || ( header->version!=s_version && !v2 )
+        || header->entrySize!=entrySize || header->stamp!=stamp
+        || sizeof( Header )+entriesSize>header->stringsOffset || header->stringsOffset>quint64( m_size )
+        || header->stringsSize!=quint64( m_size )-header->stringsOffset
+        || header->checksum!=checksum( m_map+sizeof( Header ), m_size-sizeof( Header ) ) ) {
+        qCWarning(KTIMER_LOG) << "ignoring the job snapshot" << path;
+        close();
+        return false;
+    }
+
+    m_entries = reinterpret_cast<const Entry *>( m_map+sizeof( Header ) );
+
+    // Saved before the usage was, and read only once: converted rather than used in place.
+    if( v2 ) {
+        const EntryV2 *old = reinterpret_cast<const EntryV2 *>( m_map+sizeof( Header ) );
+        m_converted.resize( header->count );
+        for( quint32 i=0; i<header->count; ++i ) {
+            Entry &entry = m_converted[i];
+            memset( &entry, 0, sizeof( entry ) );
+            memcpy( &entry, &old[i], offsetof( EntryV2, strings ) );
+            memcpy( entry.strings, old[i].strings, sizeof( old[i].strings ) );
+        }
+        m_entries = m_converted.constData();
+    }
+    m_strings = reinterpret_cast<const char *>( m_map+header->stringsOffset );
+    m_stringsSize = header->stringsSize;
+    m_count = header->count;
+    return true;
+}
+
+
+void KTimerSnapshot::close()
+{
+    if( m_map )
+        ::munmap( m_map, m_size );
+    m_map = 0;
+    m_size = 0;
+    m_entries = 0;
+    m_converted.clear();
+    m_strings = 0;
+    m_stringsSize = 0;
+    m_count = 0;
+}
+
+
+int KTimerSnapshot::count() const
+{
+    return m_count;
+}
+
+
+const KTimerSnapshot::Entry &KTimerSnapshot::entry( int index ) const
+{
+    Q_ASSERT( index>=0 && index<m_count );
+    return m_entries[index];
+}
+
+
+QString KTimerSnapshot::string( int index, String which ) const
+{
+    const quint32 offset = entry( index ).strings[which][0];
+    const quint32 length = entry( index ).strings[which][1];
+    // The checksum only vouches for what the writer wrote.
+    if( quint64( offset )+length>m_stringsSize )
+        return QString();
+    return QString::fromUtf8( m_strings+offset, length );
+}
+
+
+/***************************************************************/
+
+
+void KTimerSnapshotWriter::add( const KTimerSnapshot::Entry &entry, const QString *strings )
+{
+    KTimerSnapshot::Entry stored = entry;
+    for( int i=0; i<KTimerSnapshot::StringCount; ++i ) {
+        const QByteArray utf8 = strings[i].toUtf8();
+        QHash<QString, quint32>::const_iterator it = m_offsets.constFind( strings[i] );
+        if( it==m_offsets.constEnd() ) {
+            it = m_offsets.insert( strings[i], m_strings.size() );
+            m_strings.append( utf8 );
+        }
+        stored.strings[i][0] = it.value();
+        stored.strings[i][1] = utf8.size();
+    }
+    m_entries.append( stored );
+}
+
+
+bool KTimerSnapshotWriter::write( const QString &path, quint64 stamp )
+{
+    const QByteArray entries = QByteArray::fromRawData( reinterpret_cast<const char *>( m_entries.constData() ),
+                                                        m_entries.count() * sizeof( KTimerSnapshot::Entry ) );
+
+    Header header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, s_magic, sizeof( s_magic ) );
+    header.version = s_version;
+    header.entrySize = sizeof( KTimerSnapshot::Entry );
+    header.count = m_entries.count();
+    header.stamp = stamp;
+    header.stringsOffset = sizeof( Header ) + entries.size();
+    header.stringsSize = m_strings.size();
+
+    // One pass over both parts, as open() sees them back to back.
+    QByteArray body = entries + m_strings;
+    header.checksum = checksum( reinterpret_cast<const uchar *>( body.constData() ), body.size() );
+
+    QDir().mkpath( QFileInfo( path ).absolutePath() );
+    QSaveFile file( path );
+    if( !file.open( QIODevice::WriteOnly )
+        || file.write( reinterpret_cast<const char *>( &header ), sizeof( header ) )!=qint64( sizeof( header ) )
+        || file.write( body )!=body.size() || !file.commit() ) {
+        qCWarning(KTIMER_LOG) << "cannot write the job snapshot" << path << file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERSNAPSHOT_H_INCLUDED
+#define KTIMERSNAPSHOT_H_INCLUDED
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * The job table, mapped read-only from a file in a fixed layout.
+ *
+ * A header is followed by one fixed-size Entry per job and by a string
+ * area; entries refer to their strings by offset and length. Nothing is
+ * parsed: once the checksum over everything after the header matched, the
+ * entries are read where they lie in the mapping. A job is still built for
+ * each entry at load time, only the text parsing of ktimerrc is saved. The
+ * file is in the byte order of the machine that wrote it. Snapshots of
+ * version 2, written before the usage statistics were kept, are still read.
+ *
+ * Once a snapshot is written, the JobN groups of ktimerrc are gone: a
+ * snapshot that cannot be opened leaves the store without its jobs, see
+ * KTimerJobStore::load().
+ *
+ * A snapshot also carries a stamp, which must match the one the caller
+ * kept next to it, so a snapshot left over from an older save is refused.
+ */
+class KTimerSnapshot {
+ public:
+    // The usage strings are KTimerUsageStats::toString().
+    enum String { Command, OnSchedule, OnPause, OnResume, OnStop, OnSuccess, OnFailure, Group,
+                  CommandUsage, HookUsage, StringCount };
+    enum Flag {
+        Loop = 0x01,
+        OneInstance = 0x02,
+        Consecutive = 0x04,
+        Batch = 0x08,
+        Coprocess = 0x10,
+        PipeOutput = 0x20
+    };
+
+    struct Entry {
+        qint64 expires;     // time_t of the expiry of a started job, else 0
+        quint32 id;
+        quint32 delay;
+        quint32 value;
+        quint32 flags;
+        quint32 captureSize;
+        quint32 slack;
+        quint32 maxRuntime;
+        qint32 priority;
+        qint32 catchUp;
+        quint32 maxCatchUp;
+        qint32 state;
+        quint32 strings[StringCount][2];    // offset and length in the string area
+    };
+
+    KTimerSnapshot();
+    ~KTimerSnapshot();
+
+    static QString defaultPath();
+
+    // Maps the file and checks it; false if it is missing, damaged or stale.
+    bool open( const QString &path, quint64 stamp );
+    void close();
+
+    int count() const;
+    const Entry &entry( int index ) const;
+    QString string( int index, String which ) const;
+
+ private:
+    Q_DISABLE_COPY(KTimerSnapshot)
+
+    uchar *m_map;
+    qint64 m_size;
+    const Entry *m_entries;
+    QVector<Entry> m_converted;     // of an older version
+    const char *m_strings;
+    quint64 m_stringsSize;
+    int m_count;
+};
+
+/**
+ * Collects jobs and writes them as a KTimerSnapshot.
+ */
+class KTimerSnapshotWriter {
+ public:
+    // 'strings' holds StringCount strings, in the order of KTimerSnapshot::String.
+    void add( const KTimerSnapshot::Entry &entry, const QString *strings );
+    // Replaces the file atomically.
+    bool write( const QString &path, quint64 stamp );
+
+ private:
+    QVector<KTimerSnapshot::Entry> m_entries;
+    QByteArray m_strings;
+    QHash<QString, quint32> m_offsets;     // jobs share commands and groups
+};
+
+#endif
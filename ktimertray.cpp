@@ -0,0 +1,92 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimertray.h"
+#include "ktimer.h"
+#include "ktimergroup.h"
+
+#include <QAction>
+#include <QMenu>
+#include <KLocalizedString>
+#include <KStatusNotifierItem>
+
+KTimerTray::KTimerTray( KTimerJobStore *store, QObject *parent )
+    : QObject( parent )
+{
+    m_store = store;
+    m_window = 0;
+
+    m_tray = new KStatusNotifierItem( this );
+    m_tray->setIconByName( QStringLiteral( "ktimer" ) );
+    m_tray->setCategory( KStatusNotifierItem::ApplicationStatus );
+    m_tray->setStatus( KStatusNotifierItem::Active );
+    // Only asked for while there is no window to show or hide.
+    connect(m_tray, &KStatusNotifierItem::activateRequested, this, &KTimerTray::activated);
+
+    // Freezes every countdown at once, see KTimerGroup.
+    m_pauseAll = new QAction( QIcon::fromTheme( QStringLiteral( "media-playback-pause" ) ), i18n( "&Pause All Timers" ), this );
+    m_pauseAll->setCheckable( true );
+    m_pauseAll->setChecked( KTimerGroup::global()->isPaused() );
+    m_tray->contextMenu()->addAction( m_pauseAll );
+    connect(m_pauseAll, &QAction::toggled, KTimerGroup::global(), [](bool pause) {
+        if( pause )
+            KTimerGroup::global()->pause();
+        else
+            KTimerGroup::global()->resume();
+    });
+    connect(KTimerGroup::global(), &KTimerGroup::stateChanged, this, &KTimerTray::groupChanged);
+
+	// TODO: Somehow replace the 'are you sure?' nuisance....
+	//KStandardAction::quit(this, SLOT(exit()), tray->d->actionCollection);
+}
+
+
+KTimerTray::~KTimerTray()
+{
+}
+
+
+KTimerPref *KTimerTray::window()
+{
+    if( !m_window ) {
+        m_window = new KTimerPref( m_store );
+        m_tray->setAssociatedWidget( m_window );
+    }
+    return m_window;
+}
+
+
+void KTimerTray::showWindow()
+{
+    KTimerPref *pref = window();
+    pref->show();
+    pref->raise();
+    pref->activateWindow();
+}
+
+
+void KTimerTray::activated( bool, const QPoint & )
+{
+    showWindow();
+}
+
+
+void KTimerTray::groupChanged( KTimerGroup *group )
+{
+    m_pauseAll->setChecked( group->isPaused() );
+}
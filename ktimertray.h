@@ -0,0 +1,60 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERTRAY_H_INCLUDED
+#define KTIMERTRAY_H_INCLUDED
+
+#include <QObject>
+#include <QPoint>
+
+class QAction;
+class KStatusNotifierItem;
+class KTimerGroup;
+class KTimerJobStore;
+class KTimerPref;
+
+/**
+ * The tray icon, which is all there is of ktimer until the window is opened.
+ *
+ * The window (KTimerPref) is built the first time it is asked for, from
+ * the tray or at startup, and kept from then on.
+ */
+class KTimerTray : public QObject {
+ Q_OBJECT
+
+ public:
+    explicit KTimerTray( KTimerJobStore *store, QObject *parent=0 );
+    virtual ~KTimerTray();
+
+    KTimerPref *window();
+
+ public slots:
+    void showWindow();
+
+ private slots:
+    void activated( bool active, const QPoint &pos );
+    void groupChanged( KTimerGroup *group );
+
+ private:
+    KTimerJobStore *m_store;
+    KStatusNotifierItem *m_tray;
+    QAction *m_pauseAll;
+    KTimerPref *m_window;
+};
+
+#endif
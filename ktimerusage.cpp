@@ -0,0 +1,132 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "ktimerusage.h"
+
+#include <QStringList>
+
+#include <algorithm>
+
+KTimerUsageStats::KTimerUsageStats()
+{
+    clear();
+}
+
+
+void KTimerUsageStats::add( const KTimerUsage &usage )
+{
+    if( m_samples.isEmpty() )
+        m_samples.resize( Window*MetricCount );
+
+    const quint32 values[MetricCount] = {
+        usage.userMs, usage.systemMs, usage.userMs + usage.systemMs, usage.maxRssKb, usage.wallMs
+    };
+
+    quint32 *row = m_samples.data() + ( m_count % Window )*MetricCount;
+    for( int i=0; i<MetricCount; ++i ) {
+        row[i] = values[i];
+        m_max[i] = qMax( m_max[i], values[i] );
+    }
+
+    m_count++;
+}
+
+
+void KTimerUsageStats::clear()
+{
+    m_samples.clear();
+    for( int i=0; i<MetricCount; ++i )
+        m_max[i] = 0;
+    m_count = 0;
+}
+
+
+quint64 KTimerUsageStats::count() const
+{
+    return m_count;
+}
+
+
+quint32 KTimerUsageStats::percentile( Metric metric, int p ) const
+{
+    const int n = (int)qMin<quint64>( m_count, Window );
+    if( n==0 )
+        return 0;
+
+    quint32 values[Window];
+    for( int i=0; i<n; ++i )
+        values[i] = m_samples.at( i*MetricCount + metric );
+
+    // Nearest rank.
+    const int rank = qBound( 0, ( p*n + 99 ) / 100 - 1, n-1 );
+    std::nth_element( values, values + rank, values + n );
+    return values[rank];
+}
+
+
+quint32 KTimerUsageStats::maximum( Metric metric ) const
+{
+    return m_max[metric];
+}
+
+
+// The count, the maxima, then the rows of the window as they lie, which the
+// count puts back in order.
+QString KTimerUsageStats::toString() const
+{
+    if( m_count==0 )
+        return QString();
+
+    QStringList numbers;
+    numbers << QString::number( m_count );
+    for( int i=0; i<MetricCount; ++i )
+        numbers << QString::number( m_max[i] );
+    const int n = (int)qMin<quint64>( m_count, Window )*MetricCount;
+    for( int i=0; i<n; ++i )
+        numbers << QString::number( m_samples.at( i ) );
+    return numbers.join( QLatin1Char( ' ' ) );
+}
+
+
+void KTimerUsageStats::fromString( const QString &text )
+{
+    clear();
+    const QStringList numbers = text.split( QLatin1Char( ' ' ), QString::SkipEmptyParts );
+    if( numbers.isEmpty() )
+        return;
+
+    bool ok;
+    const quint64 count = numbers.at( 0 ).toULongLong( &ok );
+    const int n = (int)qMin<quint64>( count, Window )*MetricCount;
+    if( !ok || count==0 || numbers.count()!=1+MetricCount+n )
+        return;
+
+    m_samples.resize( Window*MetricCount );
+    for( int i=0; i<MetricCount+n && ok; ++i ) {
+        const quint32 value = numbers.at( 1+i ).toUInt( &ok );
+        if( i<MetricCount )
+            m_max[i] = value;
+        else
+            m_samples[i-MetricCount] = value;
+    }
+    if( !ok ) {
+        clear();
+        return;
+    }
+    m_count = count;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2026 The KTimer Authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef KTIMERUSAGE_H_INCLUDED
+#define KTIMERUSAGE_H_INCLUDED
+
+#include <QString>
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * Resources used by one finished child process, as reported by wait4().
+ */
+struct KTimerUsage {
+    quint32 userMs;
+    quint32 systemMs;
+    quint32 maxRssKb;
+    quint32 wallMs;
+};
+
+/**
+ * Rolling statistics over the resource usage of the last runs of a command.
+ *
+ * Only the last Window samples are kept, in one flat array that is
+ * allocated on the first sample, so jobs that never ran cost nothing.
+ * Maxima are kept over all samples.
+ */
+class KTimerUsageStats {
+ public:
+    enum Metric { UserTime, SystemTime, CpuTime, MaxRss, WallTime, MetricCount };
+
+    KTimerUsageStats();
+
+    void add( const KTimerUsage &usage );
+    void clear();
+
+    quint64 count() const;
+    // The p-th percentile over the last Window samples.
+    quint32 percentile( Metric metric, int p ) const;
+    quint32 maximum( Metric metric ) const;
+
+    // The window, maxima and count as a line of numbers, to be saved with
+    // the job; empty before the first sample. A string fromString() does
+    // not understand clears the statistics.
+    QString toString() const;
+    void fromString( const QString &text );
+
+ private:
+    enum { Window = 32 };
+
+    QVector<quint32> m_samples;     // Window rows of MetricCount values
+    quint32 m_max[MetricCount];
+    quint64 m_count;
+};
+
+#endif
@@ -24,15 +24,124 @@
 #include <QCommandLineParser>
 #include <kdelibs4configmigrator.h>
 #include <KDBusService>
+#include <KSharedConfig>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <limits>
+
 #include "ktimer.h"
+#include "ktimerarchive.h"
+#include "ktimercontrol.h"
+#include "ktimereventlog.h"
+#include "ktimerjobstore.h"
+#include "ktimerleader.h"
+#include "ktimertray.h"
+#include "ktimer_debug.h"
 
 static const char description[] =
         I18N_NOOP("KDE Timer");
 
 static const char version[] = "v0.10";
 
+// Opens a file named on the command line, "-" being stdin or stdout.
+static bool openArchive( QFile *file, const QString &name, QIODevice::OpenMode mode )
+{
+    if( name==QLatin1String( "-" ) )
+        return file->open( mode & QIODevice::ReadOnly ? stdin : stdout, mode );
+    file->setFileName( name );
+    return file->open( mode );
+}
+
+// --import and --export work on the saved jobs, a running ktimer picks up the result.
+static int runBatch( const QCommandLineParser &parser )
+{
+    KSharedConfig::Ptr cfg = KSharedConfig::openConfig();
+    QTextStream err( stderr );
+    QFile file;
+
+    if( parser.isSet( QStringLiteral( "export" ) ) ) {
+        const QString name = parser.value( QStringLiteral( "export" ) );
+        if( !openArchive( &file, name, QIODevice::WriteOnly ) ) {
+            err << i18n( "Cannot write %1: %2", name, file.errorString() ) << "\n";
+            return 1;
+        }
+        KTimerJobWriter writer( &file );
+        if( writer.writeAll( cfg.data() )<0 ) {
+            err << i18n( "Cannot write %1: %2", name, writer.errorString() ) << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    const QString name = parser.value( QStringLiteral( "import" ) );
+    if( !openArchive( &file, name, QIODevice::ReadOnly ) ) {
+        err << i18n( "Cannot read %1: %2", name, file.errorString() ) << "\n";
+        return 1;
+    }
+    KTimerJobReader reader( &file );
+    const int count = reader.readAll( cfg.data() );
+    if( count<0 ) {
+        // Nothing of a broken archive gets saved.
+        cfg->markAsClean();
+        err << i18n( "Cannot read %1: %2", name, reader.errorString() ) << "\n";
+        return 1;
+    }
+    if( !cfg->sync() ) {
+        err << i18n( "Cannot save the imported jobs." ) << "\n";
+        return 1;
+    }
+    err << i18np( "Imported 1 job.", "Imported %1 jobs.", count ) << "\n";
+    return 0;
+}
+
+// --events prints what the event log holds about a job and time range, one run per line.
+static int runEvents( const QCommandLineParser &parser )
+{
+    QTextStream err( stderr );
+    KTimerEventLog log;
+    if( !log.openReadOnly( KTimerEventLog::defaultPath() ) ) {
+        err << i18n( "No event log at %1.", KTimerEventLog::defaultPath() ) << "\n";
+        return 1;
+    }
+
+    qint64 since = 0;
+    qint64 until = std::numeric_limits<qint64>::max();
+    const char *const bounds[] = { "since", "until" };
+    for( int i=0; i<2; ++i ) {
+        const QString name = QString::fromLatin1( bounds[i] );
+        if( !parser.isSet( name ) )
+            continue;
+        const QDateTime time = QDateTime::fromString( parser.value( name ), Qt::ISODate );
+        if( !time.isValid() ) {
+            err << i18n( "Not a date and time: %1", parser.value( name ) ) << "\n";
+            return 1;
+        }
+        ( i==0 ? since : until ) = time.toMSecsSinceEpoch();
+    }
+    const quint32 job = parser.value( QStringLiteral( "job" ) ).toUInt();
+
+    static const char *const types[] = { "?", "fired", "succeeded", "failed" };
+    QTextStream out( stdout );
+    const QVector<KTimerEvent> events = log.query( job, since, until );
+    for( int i=0; i<events.count(); ++i ) {
+        const KTimerEvent &event = events.at( i );
+        out << QDateTime::fromMSecsSinceEpoch( event.time ).toString( QStringLiteral( "yyyy-MM-ddTHH:mm:ss.zzz" ) ) << '\t'
+            << event.job << '\t' << types[event.type<=KTimerEvent::Failed ? event.type : 0];
+        if( event.type!=KTimerEvent::Fired )
+            out << '\t' << event.status << '\t' << event.duration;
+        out << '\n';
+    }
+    return 0;
+}
+
 int main( int argc, char **argv )
 {
+    QElapsedTimer startup;
+    startup.start();
     QApplication app(argc, argv);
 
     /**
@@ -55,14 +164,51 @@ int main( int argc, char **argv )
     parser.addVersionOption();
     parser.addHelpOption();
     aboutData.setupCommandLine(&parser);
+    parser.addOption(QCommandLineOption(QStringLiteral("import"), i18n("Add the jobs of an archive to the saved ones, and exit."), QStringLiteral("file")));
+    parser.addOption(QCommandLineOption(QStringLiteral("export"), i18n("Write the saved jobs to an archive, and exit."), QStringLiteral("file")));
+    parser.addOption(QCommandLineOption(QStringLiteral("events"), i18n("Print the logged runs of the jobs, and exit.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("job"), i18n("With --events, only the runs of the job with this id."), QStringLiteral("id")));
+    parser.addOption(QCommandLineOption(QStringLiteral("since"), i18n("With --events, only runs from this time on (ISO 8601)."), QStringLiteral("time")));
+    parser.addOption(QCommandLineOption(QStringLiteral("until"), i18n("With --events, only runs up to this time (ISO 8601)."), QStringLiteral("time")));
+    parser.addOption(QCommandLineOption(QStringLiteral("tray"), i18n("Start in the system tray, without opening the window.")));
+    parser.addOption(QCommandLineOption(QStringLiteral("state-dir"), i18n("Keep the jobs in this directory; of all ktimers using it, one runs the jobs and the others follow."), QStringLiteral("directory")));
     parser.process(app);
     aboutData.processCommandLine(&parser);
 
+    // Before anything opens the config.
+    if( parser.isSet( QStringLiteral( "state-dir" ) ) ) {
+        const QString dir = QDir( parser.value( QStringLiteral( "state-dir" ) ) ).absolutePath();
+        KConfig::setMainConfigName( dir + QStringLiteral( "/ktimerrc" ) );
+        KTimerLeader::setDefaultDirectory( dir );
+    }
+
+    if( parser.isSet( QStringLiteral( "import" ) ) || parser.isSet( QStringLiteral( "export" ) ) )
+        return runBatch( parser );
+    if( parser.isSet( QStringLiteral( "events" ) ) )
+        return runEvents( parser );
+
     app.setQuitOnLastWindowClosed( false );
     KDBusService service;
+    new KTimerControl( &app );
+
+    KTimerJobStore *store = new KTimerJobStore( &app );
+    // Only ktimers given a state directory look out for each other.
+    if( parser.isSet( QStringLiteral( "state-dir" ) ) && !store->share() ) {
+        QTextStream( stderr ) << i18n( "Cannot take part in running the jobs of %1, as its lock files cannot be opened.",
+                                       KTimerLeader::defaultDirectory() ) << "\n";
+        return 1;
+    }
+    store->watch();
+    store->openEventLog();
+    store->load( KSharedConfig::openConfig().data() );
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, store, &KTimerJobStore::saveAll);
+
+    // The window, and a row for every job, only once somebody wants to see them.
+    KTimerTray *tray = new KTimerTray( store, &app );
+    if( !parser.isSet( QStringLiteral( "tray" ) ) )
+        tray->showWindow();
 
-    KTimerPref *timer = new KTimerPref;
-    timer->show();
+    qCDebug(KTIMER_LOG) << "started with" << store->count() << "jobs in" << startup.elapsed() << "ms";
 
     return app.exec();
 }